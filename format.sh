@@ -13,7 +13,7 @@
 
 set -eu
 
-CPP_FILES=$(find src -type f \( -iname "*.cpp" -o -iname "*.h" \))
+CPP_FILES=$(find src tests -type f \( -iname "*.cpp" -o -iname "*.h" \))
 clang-format -i $CPP_FILES
 
 QML_FILES=$(find src/qml -type f \( -iname "*.qml" \))
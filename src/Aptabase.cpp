@@ -9,6 +9,7 @@
 #include <QNetworkReply>
 #include <QRandomGenerator64>
 #include <QSettings>
+#include <QThread>
 
 Aptabase::Aptabase()
     : QObject{nullptr}
@@ -53,6 +54,16 @@ void Aptabase::track(const QString &event, const QJsonObject &properties, bool b
     if (!m_enabled)
         return;
 
+    // Stores scan on background threads, but the network access manager belongs to the main thread
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(
+            const_cast<Aptabase *>(this),
+            [this, event, properties, blocking] { track(event, properties, blocking); },
+            blocking ? Qt::BlockingQueuedConnection : Qt::QueuedConnection);
+        return;
+    }
+
     static QNetworkAccessManager net;
     net.setAutoDeleteReplies(true);
 
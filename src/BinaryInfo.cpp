@@ -0,0 +1,235 @@
+#include "BinaryInfo.h"
+
+#include <QFile>
+#include <QLoggingCategory>
+#include <QtEndian>
+
+Q_LOGGING_CATEGORY(BinaryInfoLog, "binaryinfo")
+
+namespace
+{
+    // Enough for the headers of anything sane. This much is read up front, and anything the headers point past it is read
+    // when a parser gets to it.
+    constexpr qint64 HEAD_SIZE = 4096;
+    // Reads past the head are rounded out to this, since what the headers point at tends to come in runs
+    constexpr qint64 WINDOW_SIZE = 8192;
+    // The import directory and the names it points at are usually close together, but not always within one window
+    constexpr qsizetype MAX_WINDOWS = 4;
+    // Nobody links against this many DLLs; anything past it is most likely garbage
+    constexpr qsizetype MAX_IMPORTS = 512;
+    constexpr qsizetype MAX_NAME_LENGTH = 4096;
+
+    // A file's bytes, of which only the head is in memory to begin with. Reading the rest with plain reads rather than
+    // mapping the file means a file that shrinks while we look at it gives short reads instead of SIGBUS.
+    class Source
+    {
+    public:
+        explicit Source(QByteArrayView head, QIODevice *file = nullptr)
+            : m_head{head}
+            , m_file{file}
+        {}
+
+        // Up to size bytes at offset, fewer if the file ends first. Only valid until the next call.
+        QByteArrayView view(qint64 offset, qsizetype size)
+        {
+            if (offset < 0)
+                return {};
+            if (offset + size <= m_head.size() || (!m_file && offset < m_head.size()))
+                return m_head.sliced(offset).first(std::min<qint64>(size, m_head.size() - offset));
+            if (!m_file)
+                return {};
+
+            for (const auto &window : std::as_const(m_windows))
+            {
+                if (offset >= window.offset && offset + size <= window.offset + window.data.size())
+                    return QByteArrayView{window.data}.sliced(offset - window.offset, size);
+            }
+
+            const auto start = offset & ~(WINDOW_SIZE - 1);
+            if (!m_file->seek(start))
+                return {};
+            if (m_windows.size() == MAX_WINDOWS)
+                m_windows.removeFirst();
+            m_windows.push_back({start, m_file->read(std::max(WINDOW_SIZE, offset - start + size))});
+
+            const QByteArrayView data{m_windows.last().data};
+            if (offset - start >= data.size())
+                return {};
+            return data.sliced(offset - start).first(std::min<qint64>(size, data.size() - (offset - start)));
+        }
+
+    private:
+        struct Window
+        {
+            qint64 offset;
+            QByteArray data;
+        };
+
+        QByteArrayView m_head;
+        QIODevice *m_file;
+        QList<Window> m_windows;
+    };
+
+    // Bounds checked reads from a file's bytes. Reads that fall outside the file come back as zero and mark the reader
+    // as failed, so a parser can do all its reads and only check once.
+    class Reader
+    {
+    public:
+        explicit Reader(Source &source, bool bigEndian = false)
+            : m_source{source}
+            , m_bigEndian{bigEndian}
+        {}
+
+        template<typename T>
+        T read(qint64 offset)
+        {
+            const auto bytes = m_source.view(offset, sizeof(T));
+            if (bytes.size() < static_cast<qsizetype>(sizeof(T)))
+            {
+                m_ok = false;
+                return 0;
+            }
+            return m_bigEndian ? qFromBigEndian<T>(bytes.data()) : qFromLittleEndian<T>(bytes.data());
+        }
+
+        // A NUL terminated string, or nothing if it doesn't end within maxLength bytes. Only valid until the next read.
+        QByteArrayView string(qint64 offset, qsizetype maxLength)
+        {
+            const auto available = m_source.view(offset, maxLength);
+            const auto end = available.indexOf('\0');
+            return end < 0 ? QByteArrayView{} : available.first(end);
+        }
+
+        bool ok() const { return m_ok; }
+
+    private:
+        Source &m_source;
+        bool m_bigEndian;
+        bool m_ok = true;
+    };
+
+    // https://learn.microsoft.com/en-us/windows/win32/debug/pe-format
+    BinaryInfo parsePe(Source &source)
+    {
+        Reader r{source};
+        if (r.read<uint16_t>(0) != 0x5A4D) // MZ
+            return {};
+
+        const qint64 pe = r.read<uint32_t>(0x3C);
+        if (r.read<uint32_t>(pe) != 0x00004550 || !r.ok()) // PE\0\0
+            return {};
+
+        BinaryInfo info;
+        info.format = BinaryInfo::Format::PE;
+        info.machine = r.read<uint16_t>(pe + 4);
+        const auto sectionCount = r.read<uint16_t>(pe + 6);
+        const auto optionalHeaderSize = r.read<uint16_t>(pe + 20);
+
+        const auto optionalHeader = pe + 24;
+        const auto magic = r.read<uint16_t>(optionalHeader);
+        if (magic != 0x10B && magic != 0x20B) // PE32 and PE32+
+            return info;
+        info.is64Bit = magic == 0x20B;
+        info.subsystem = r.read<uint16_t>(optionalHeader + 68);
+
+        const auto directoryCount = r.read<uint32_t>(optionalHeader + (info.is64Bit ? 108 : 92));
+        const auto directories = optionalHeader + (info.is64Bit ? 112 : 96);
+        const auto importRva = directoryCount > 1 ? r.read<uint32_t>(directories + 8) : 0;
+        if (importRva == 0)
+            return info;
+
+        // The import directory and the names in it are given as RVAs, which the section table maps to file offsets
+        const auto sections = optionalHeader + optionalHeaderSize;
+        const auto toOffset = [&r, sections, sectionCount](uint32_t rva) -> qint64 {
+            for (int i = 0; i < sectionCount; ++i)
+            {
+                const auto section = sections + i * 40;
+                const uint64_t address = r.read<uint32_t>(section + 12);
+                const auto size = std::max(r.read<uint32_t>(section + 8), r.read<uint32_t>(section + 16));
+                if (rva >= address && rva < address + size)
+                    return r.read<uint32_t>(section + 20) + (rva - address);
+            }
+            return -1;
+        };
+
+        // Import descriptors are 20 bytes each, and the list ends with one that's all zeroes
+        for (auto descriptor = toOffset(importRva); descriptor >= 0 && info.imports.size() < MAX_IMPORTS; descriptor += 20)
+        {
+            const auto nameRva = r.read<uint32_t>(descriptor + 12);
+            if (nameRva == 0 || !r.ok())
+                break;
+            if (const auto name = r.string(toOffset(nameRva), MAX_NAME_LENGTH); !name.isEmpty())
+                info.imports.push_back(QString::fromLatin1(name));
+        }
+
+        return info;
+    }
+
+    // https://refspecs.linuxfoundation.org/elf/gabi4+/ch4.eheader.html
+    BinaryInfo parseElf(Source &source)
+    {
+        const auto ident = source.view(0, 6);
+        if (ident.size() < 6 || !ident.startsWith("\177ELF"))
+            return {};
+
+        // Class (32/64 bit) and data encoding (endianness)
+        const auto elfClass = ident[4];
+        const auto encoding = ident[5];
+        if ((elfClass != 1 && elfClass != 2) || (encoding != 1 && encoding != 2))
+            return {};
+
+        Reader r{source, encoding == 2};
+        BinaryInfo info;
+        info.is64Bit = elfClass == 2;
+        info.machine = r.read<uint16_t>(18);
+        if (!r.ok())
+            return {};
+        info.format = BinaryInfo::Format::ELF;
+
+        // Look through the program headers for the interpreter
+        const auto programHeaders = static_cast<qint64>(info.is64Bit ? r.read<uint64_t>(32) : r.read<uint32_t>(28));
+        const auto entrySize = r.read<uint16_t>(info.is64Bit ? 54 : 42);
+        const auto entryCount = r.read<uint16_t>(info.is64Bit ? 56 : 44);
+        for (int i = 0; i < entryCount && r.ok(); ++i)
+        {
+            const auto header = programHeaders + static_cast<qint64>(i) * entrySize;
+            if (r.read<uint32_t>(header) != 3) // PT_INTERP
+                continue;
+
+            const auto offset =
+                static_cast<qint64>(info.is64Bit ? r.read<uint64_t>(header + 8) : r.read<uint32_t>(header + 4));
+            info.interpreter = QString::fromUtf8(r.string(offset, MAX_NAME_LENGTH));
+            break;
+        }
+
+        return info;
+    }
+} // namespace
+
+BinaryInfo BinaryInfo::read(const QString &path)
+{
+    // Unbuffered, so that each read asks for exactly what the parsers need
+    QFile file{path};
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+    {
+        qCDebug(BinaryInfoLog) << "Could not open" << path << "-" << file.errorString();
+        return {};
+    }
+
+    const auto head = file.read(HEAD_SIZE);
+    if (head.isEmpty())
+        return {};
+
+    Source source{head, &file};
+    if (auto info = parsePe(source); info.isValid())
+        return info;
+    return parseElf(source);
+}
+
+BinaryInfo BinaryInfo::parse(QByteArrayView data)
+{
+    Source source{data};
+    if (auto info = parsePe(source); info.isValid())
+        return info;
+    return parseElf(source);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+#include <QByteArrayView>
+#include <QString>
+#include <QStringList>
+
+// What an executable's headers say about it. Everything comes out of one look at the file, so anything that wants to know
+// more than one of these never has to open the binary again.
+struct BinaryInfo
+{
+    enum class Format
+    {
+        Unknown,
+        PE,
+        ELF,
+    };
+
+    Format format = Format::Unknown;
+    // IMAGE_FILE_MACHINE_* for PE, EM_* for ELF
+    uint16_t machine = 0;
+    bool is64Bit = false;
+
+    // PE only
+    uint16_t subsystem = 0; // IMAGE_SUBSYSTEM_*, e.g. 2 for GUI apps and 3 for console apps
+    QStringList imports;    // DLLs in the import directory, e.g. UnityPlayer.dll or openvr_api.dll
+
+    // ELF only
+    QString interpreter; // PT_INTERP, e.g. /lib64/ld-linux-x86-64.so.2
+
+    bool isValid() const { return format != Format::Unknown; }
+    // DLL names are case insensitive on Windows, so this is too
+    bool hasImport(QLatin1StringView dll) const { return imports.contains(dll, Qt::CaseInsensitive); }
+
+    // Reads the start of the file, then only the other ranges the headers point at
+    static BinaryInfo read(const QString &path);
+    static BinaryInfo parse(QByteArrayView data);
+};
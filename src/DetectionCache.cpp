@@ -0,0 +1,124 @@
+#include "DetectionCache.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+Q_LOGGING_CATEGORY(DetectionCacheLog, "detector.cache")
+
+namespace
+{
+    constexpr quint32 CACHE_MAGIC = 0x4B444554; // "KDET"
+    constexpr quint32 CACHE_VERSION = 2;
+
+    // Games that haven't been looked up for this long have most likely been uninstalled
+    constexpr qint64 MAX_AGE_SECS = 30 * 24 * 60 * 60;
+
+    QString cachePath()
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/detection.cache"_L1;
+    }
+} // namespace
+
+QDataStream &operator<<(QDataStream &s, const DetectionCache::Entry &entry)
+{
+    return s << entry.fingerprint << entry.engine << entry.anticheat << entry.engineDecided << entry.anticheatDecided
+             << entry.architectures << entry.lastSeen;
+}
+
+QDataStream &operator>>(QDataStream &s, DetectionCache::Entry &entry)
+{
+    return s >> entry.fingerprint >> entry.engine >> entry.anticheat >> entry.engineDecided >> entry.anticheatDecided >>
+           entry.architectures >> entry.lastSeen;
+}
+
+DetectionCache::DetectionCache()
+{
+    QFile file{cachePath()};
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream s{&file};
+    s.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    s >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+    {
+        qCInfo(DetectionCacheLog) << "Ignoring detection cache with unknown format" << Qt::hex << magic << version;
+        return;
+    }
+
+    QHash<QString, Entry> entries;
+    s >> entries;
+    if (s.status() != QDataStream::Ok)
+    {
+        qCWarning(DetectionCacheLog) << "Failed to read detection cache" << file.fileName();
+        return;
+    }
+
+    m_entries = std::move(entries);
+    qCDebug(DetectionCacheLog) << "Loaded" << m_entries.size() << "games from detection cache";
+}
+
+DetectionCache *DetectionCache::instance()
+{
+    static auto d = new DetectionCache;
+    return d;
+}
+
+std::optional<DetectionCache::Entry> DetectionCache::find(const QString &key, const QString &fingerprint)
+{
+    QMutexLocker lock{&m_mutex};
+
+    const auto it = m_entries.find(key);
+    if (it == m_entries.end() || it->fingerprint != fingerprint)
+        return std::nullopt;
+
+    // Only bother writing the new timestamp out once it's a day old
+    if (const auto now = QDateTime::currentSecsSinceEpoch(); now - it->lastSeen > 24 * 60 * 60)
+    {
+        it->lastSeen = now;
+        m_dirty = true;
+    }
+    return *it;
+}
+
+void DetectionCache::insert(const QString &key, Entry entry)
+{
+    QMutexLocker lock{&m_mutex};
+
+    entry.lastSeen = QDateTime::currentSecsSinceEpoch();
+    m_entries.insert(key, std::move(entry));
+    m_dirty = true;
+}
+
+void DetectionCache::save()
+{
+    QMutexLocker lock{&m_mutex};
+
+    const auto oldest = QDateTime::currentSecsSinceEpoch() - MAX_AGE_SECS;
+    const auto pruned = m_entries.removeIf(
+        [oldest](const std::pair<const QString &, Entry &> &entry) { return entry.second.lastSeen < oldest; });
+    if (!m_dirty && pruned == 0)
+        return;
+
+    QSaveFile file{cachePath()};
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCWarning(DetectionCacheLog) << "Failed to write detection cache" << file.fileName();
+        return;
+    }
+
+    QDataStream s{&file};
+    s.setVersion(QDataStream::Qt_6_0);
+    s << CACHE_MAGIC << CACHE_VERSION << m_entries;
+
+    if (file.commit())
+        m_dirty = false;
+    else
+        qCWarning(DetectionCacheLog) << "Failed to write detection cache" << file.fileName();
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+
+#include <QDataStream>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+#include "Game.h"
+
+// Remembers what detection found for each game between runs, so that games whose install hasn't changed don't have to be
+// walked again. Safe to use from any thread.
+class DetectionCache
+{
+public:
+    struct Entry
+    {
+        QString fingerprint;
+        Game::Engine engine = Game::UnknownEngine;
+        bool anticheat = false;
+        // What detection couldn't tell within its budget is left for finishDetection() instead of being guessed at
+        bool engineDecided = true;
+        bool anticheatDecided = true;
+        QHash<QString, Game::Architecture> architectures; // By executable path
+        qint64 lastSeen = 0;                              // Seconds since the epoch
+    };
+
+    static DetectionCache *instance();
+
+    // key identifies the game, fingerprint the state of its install. Only returns an entry if both match.
+    std::optional<Entry> find(const QString &key, const QString &fingerprint);
+    void insert(const QString &key, Entry entry);
+
+    // Writes the cache to disk if anything changed, dropping games that haven't been seen in a while
+    void save();
+
+private:
+    DetectionCache();
+
+    QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    bool m_dirty = false;
+};
+
+QDataStream &operator<<(QDataStream &s, const DetectionCache::Entry &entry);
+QDataStream &operator>>(QDataStream &s, DetectionCache::Entry &entry);
@@ -0,0 +1,129 @@
+#include "DirWalker.h"
+
+#include <QDirIterator>
+#include <QFile>
+
+#if defined(Q_OS_LINUX)
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+namespace
+{
+    // The kernel's record layout for getdents64(). glibc only exposes it under _GNU_SOURCE and musl not at all.
+    struct LinuxDirent64
+    {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    constexpr size_t DIRENT_BUFFER_SIZE = 32 * 1024;
+    constexpr int ROOT_OPEN_FLAGS = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+    constexpr int OPEN_FLAGS = ROOT_OPEN_FLAGS | O_NOFOLLOW;
+} // namespace
+
+DirWalker::DirWalker(const QString &root)
+{
+    // The root itself may well be a symlink, e.g. to a library on another drive. Only what's inside it isn't followed.
+    if (const auto fd = open(QFile::encodeName(root).constData(), ROOT_OPEN_FLAGS); fd >= 0)
+        enter(fd);
+}
+
+DirWalker::~DirWalker()
+{
+    for (size_t i = 0; i < m_depth; ++i)
+        close(m_levels[i].fd);
+}
+
+bool DirWalker::next()
+{
+    // Go into the directory that was handed out last, now that the caller is done looking at it
+    if (m_descend)
+    {
+        m_descend = false;
+        if (const auto fd = openat(m_levels[m_depth - 1].fd, m_path.c_str() + m_nameOffset, OPEN_FLAGS); fd >= 0)
+            enter(fd);
+    }
+
+    while (m_depth > 0)
+    {
+        auto &level = m_levels[m_depth - 1];
+        if (level.pos >= level.size)
+        {
+            level.size = syscall(SYS_getdents64, level.fd, level.buffer.data(), level.buffer.size());
+            level.pos = 0;
+            if (level.size <= 0)
+            {
+                close(level.fd);
+                --m_depth;
+                continue;
+            }
+        }
+
+        const auto entry = reinterpret_cast<const LinuxDirent64 *>(level.buffer.data() + level.pos);
+        level.pos += entry->d_reclen;
+
+        const std::string_view name{entry->d_name};
+        if (name == "." || name == "..")
+            continue;
+
+        m_path.resize(level.pathSize);
+        m_path += '/';
+        m_nameOffset = m_path.size();
+        m_path += name;
+
+        // Some filesystems don't fill in the type, in which case there's no way around asking
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            m_isDir = fstatat(level.fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+        }
+        else
+            m_isDir = entry->d_type == DT_DIR;
+
+        m_descend = m_isDir;
+        return true;
+    }
+
+    return false;
+}
+
+void DirWalker::enter(int fd)
+{
+    if (m_depth == m_levels.size())
+        m_levels.emplace_back().buffer.resize(DIRENT_BUFFER_SIZE);
+
+    auto &level = m_levels[m_depth++];
+    level.fd = fd;
+    level.pathSize = m_path.size();
+    level.pos = 0;
+    level.size = 0;
+}
+#else
+DirWalker::DirWalker(const QString &root)
+    : m_it{std::make_unique<QDirIterator>(
+          root, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, QDirIterator::Subdirectories)}
+    , m_rootSize{root.size()}
+{}
+
+DirWalker::~DirWalker() = default;
+
+bool DirWalker::next()
+{
+    if (!m_it->hasNext())
+        return false;
+
+    const auto entry = m_it->nextFileInfo();
+    m_path = QStringView{entry.filePath()}.sliced(m_rootSize).toUtf8().toStdString();
+    m_nameOffset = m_path.rfind('/') + 1;
+    m_isDir = entry.isDir() && !entry.isSymLink();
+    return true;
+}
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <QString>
+
+class QDirIterator;
+
+// Walks a directory tree depth first, listing every file and directory in it, hidden or not. Symlinks are listed but
+// never followed, apart from the root itself. Paths are UTF-8, relative to the root, and start with a slash.
+//
+// On Linux this reads directories with getdents64() and opens subdirectories relative to their parent's fd, so the
+// kernel's file type saves a stat() per entry and every path is built in the same buffer. Elsewhere it falls back to
+// QDirIterator.
+class DirWalker
+{
+public:
+    explicit DirWalker(const QString &root);
+    ~DirWalker();
+    Q_DISABLE_COPY_MOVE(DirWalker)
+
+    // Moves to the next entry. Returns false once there are none left. Views from the previous entry are invalidated.
+    bool next();
+
+    std::string_view path() const { return m_path; }
+    std::string_view fileName() const { return std::string_view{m_path}.substr(m_nameOffset); }
+    bool isDir() const { return m_isDir; }
+
+private:
+#if defined(Q_OS_LINUX)
+    struct Level
+    {
+        int fd = -1;
+        size_t pathSize = 0; // Size of m_path for the directory itself
+        std::vector<char> buffer;
+        long pos = 0;
+        long size = 0;
+    };
+
+    void enter(int fd);
+
+    // Only the first m_depth levels are in use. The rest are kept around so their buffers can be reused.
+    std::vector<Level> m_levels;
+    size_t m_depth = 0;
+    bool m_descend = false;
+#else
+    std::unique_ptr<QDirIterator> m_it;
+    qsizetype m_rootSize = 0;
+#endif
+
+    std::string m_path;
+    size_t m_nameOffset = 0;
+    bool m_isDir = false;
+};
@@ -1,22 +1,56 @@
 #include "Game.h"
 
-#include <QDirIterator>
 #include <QFileInfo>
-#include <QRegularExpression>
+#include <QFuture>
+#include <QPromise>
 
 #include "Aptabase.h"
+#include "DetectionCache.h"
+#include "GameDetector.h"
+#include "KnownGames.h"
+#include "ScanExecutor.h"
+#include "Wine.h"
+
+namespace
+{
+    // How much of an install gets walked while the game is being created. Most games are smaller than this.
+    constexpr qsizetype BOUNDED_WALK_ENTRIES = 2000;
+
+    // What a full walk off the main thread hands back
+    struct FinishedDetection
+    {
+        DetectionResult result;
+        QString fingerprint;
+    };
+} // namespace
 
 Game::Game(QObject *parent)
     : QObject{parent}
 {}
 
+QString Game::winePrefix() const
+{
+    if (m_winePrefix.isEmpty() && m_defaultWine)
+        return Wine::instance()->defaultWinePrefix();
+    return m_winePrefix;
+}
+
+QString Game::wineBinary() const
+{
+    if (m_wineBinary.isEmpty() && m_defaultWine)
+        return Wine::instance()->whichWine();
+    return m_wineBinary;
+}
+
 bool Game::hasValidWine() const
 {
-    if (m_wineBinary.isEmpty() || m_winePrefix.isEmpty())
+    const auto wineBinary = this->wineBinary();
+    const auto winePrefix = this->winePrefix();
+    if (wineBinary.isEmpty() || winePrefix.isEmpty())
         return false;
-    if (QFileInfo wb{m_wineBinary}; !wb.exists() || !wb.isFile())
+    if (QFileInfo wb{wineBinary}; !wb.exists() || !wb.isFile())
         return false;
-    if (QFileInfo wp{m_winePrefix}; !wp.exists() || !wp.isDir())
+    if (QFileInfo wp{winePrefix}; !wp.exists() || !wp.isDir())
         return false;
 
     return true;
@@ -43,284 +77,244 @@ bool Game::noWindowsSupport() const
         m_executables.begin(), m_executables.end(), [](const auto &exe) { return exe.platform != Platform::Windows; });
 }
 
-void Game::detectGameEngine()
+void Game::detect()
 {
-    QString binaryDir{m_installDir};
-    for (const auto &exe : std::as_const(m_executables))
-    {
-        if (QFileInfo fi{exe.executable}; fi.absolutePath() != m_installDir)
-        {
-            binaryDir = fi.absolutePath();
-            break;
-        }
-    }
+    detect(DetectionBudget{});
+}
 
-    // =======================================
-    // Unreal detection
-    //
-    // Detection method sourced from Rai Pal
-    // https://github.com/Raicuparta/rai-pal/blob/51157fdae6b1d87760580d85082ccd5026bb0320/backend/core/src/game_engines/unreal.rs
-    const QStringList signsOfUnreal = {
-        binaryDir + "/Engine/Binaries/Win64"_L1,
-        binaryDir + "/Engine/Binaries/Win32"_L1,
-        binaryDir + "/Engine/Binaries/ThirdParty"_L1,
-    };
-    for (const auto &sign : signsOfUnreal)
+void Game::detect(const DetectionBudget &budget)
+{
+    // Well known games don't need their install looked at, apart from maybe the executables' headers
+    if (const auto known = KnownGames::instance()->find(detectionKey()))
     {
-        if (QFileInfo fi{sign}; fi.exists() && fi.isDir())
+        m_engine = known->engine;
+        if (known->anticheat)
+            m_features.setFlag(Feature::Anticheat);
+
+        bool architecturesKnown = true;
+        for (auto &exe : m_executables)
         {
-            m_engine = Engine::Unreal;
-            return;
+            if (exe.platform == Platform::Windows)
+                exe.arch = known->windowsArch;
+            else if (exe.platform == Platform::Linux)
+                exe.arch = known->linuxArch;
+            architecturesKnown = architecturesKnown && exe.arch != Architecture::UnknownArch;
         }
+        if (!architecturesKnown)
+            detectArchitectures();
+        return;
     }
 
-    // =======================================
-    // Source detection
-    //
-    // Regex sourced from SteamDB
-    // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/ac27c7cfc0a63dc07cc9e65157841857d82f347b/rules.ini#L191
-    static const QRegularExpression signsOfSource{R"((?:^|/)(?:vphysics|bsppack)\.(?:dylib|dll|so)$)"_L1};
-    for (QDirIterator gameDirIterator{binaryDir, QDirIterator::Subdirectories}; gameDirIterator.hasNext();)
+    const auto fingerprint = installFingerprint();
+    if (const auto cached = DetectionCache::instance()->find(detectionKey(), fingerprint))
     {
-        auto localName = gameDirIterator.next().remove(binaryDir);
-        if (localName.contains(signsOfSource))
+        if (cached->engineDecided)
+            m_engine = cached->engine;
+        if (cached->anticheatDecided && cached->anticheat)
+            m_features.setFlag(Feature::Anticheat);
+        m_detectionPending = !cached->engineDecided || !cached->anticheatDecided;
+
+        // Architectures that couldn't be told aren't cached, so look at those executables again
+        bool architecturesKnown = true;
+        for (auto &exe : m_executables)
         {
-            m_engine = Engine::Source;
-            return;
+            exe.arch = cached->architectures.value(exe.executable, Architecture::UnknownArch);
+            architecturesKnown = architecturesKnown && exe.arch != Architecture::UnknownArch;
         }
+        if (!architecturesKnown)
+            detectArchitectures();
+        return;
     }
 
-    // =======================================
-    // Unity detection
-    //
-    // Detection method sourced from Rai Pal
-    // https://github.com/Raicuparta/rai-pal/blob/51157fdae6b1d87760580d85082ccd5026bb0320/backend/core/src/game_engines/unity.rs
-    for (const auto &e : std::as_const(m_executables))
+    // Only reading a few bytes of each executable, so this happens up front even when the rest has to wait
+    detectArchitectures();
+
+    if (budget.exhausted())
     {
-        QFileInfo exe{e.executable};
-        if (QFileInfo dataDir{exe.absolutePath() + '/' + exe.baseName() + "_Data"_L1}; dataDir.exists() && dataDir.isDir())
-        {
-            m_engine = Engine::Unity;
-            return;
-        }
+        applyDetection({.engineDecided = false, .anticheatDecided = false});
+        return;
     }
 
-    // Unity fallback: if the crash handler exists, it's a dead giveaway
-    for (QDirIterator gameDirIterator{m_installDir, QDirIterator::Subdirectories}; gameDirIterator.hasNext();)
+    // Tier 0: the store's metadata. Soundtracks and tools don't need an engine and aren't something anyone mods.
+    if (m_type == AppType::Music || m_type == AppType::Tool)
+        return;
+
+    // Tiers 1 and 2: probe known paths, then walk the start of the install. That's enough for most games; anything still
+    // undecided after that waits for finishDetection().
+    auto bounded = budget;
+    bounded.maxEntries = BOUNDED_WALK_ENTRIES;
+    const auto result = GameDetector{m_installDir, m_executables}.detect(!hasAnticheat(), bounded);
+    applyDetection(result);
+    cacheDetection(fingerprint, result);
+}
+
+void Game::finishDetection()
+{
+    if (!m_detectionPending || m_detectionRunning)
+        return;
+    m_detectionRunning = true;
+
+    // Tier 3: the full walk, on the scan executor so that it takes its turn on the install's drive like any other walk. The
+    // fingerprint is taken there too, since it stats the install and this may well be the GUI thread.
+    auto promise = std::make_shared<QPromise<FinishedDetection>>();
+    promise->future().then(this, [this](const FinishedDetection &finished) {
+        m_detectionRunning = false;
+        applyDetection(finished.result);
+        cacheDetection(finished.fingerprint, finished.result);
+        emit detectionFinished();
+    });
+
+    promise->start();
+    ScanExecutor::instance()->submit(
+        [promise,
+         installDir = m_installDir,
+         installVersion = m_installVersion,
+         executables = m_executables,
+         findAnticheat = !hasAnticheat()] {
+            FinishedDetection finished;
+            finished.fingerprint = installFingerprint(installDir, installVersion, executables);
+            finished.result = GameDetector{installDir, executables}.detect(findAnticheat);
+            promise->addResult(std::move(finished));
+            promise->finish();
+        },
+        m_installDir);
+}
+
+void Game::applyDetection(const DetectionResult &result)
+{
+    if (result.engineDecided && result.engine != m_engine)
     {
-        gameDirIterator.next();
-        if (gameDirIterator.fileName() == "UnityCrashHandler64.exe"_L1 ||
-            gameDirIterator.fileName() == "UnityCrashHandler32.exe"_L1)
-        {
-            m_engine = Engine::Unity;
-            return;
-        }
+        m_engine = result.engine;
+        emit engineChanged(m_engine);
     }
-
-    // =======================================
-    // Godot detection
-    //
-    // Dectection method sourced from SteamDB
-    // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/ac27c7cfc0a63dc07cc9e65157841857d82f347b/tests/FileDetector.php#L316
-    for (const auto &e : std::as_const(m_executables))
+    if (result.anticheatDecided && result.anticheat && !hasAnticheat())
     {
-        QFileInfo exe{e.executable};
-        for (QDirIterator pckFinder{exe.absolutePath()}; pckFinder.hasNext();)
-        {
-            pckFinder.next();
-            if (pckFinder.fileName().toLower() == exe.baseName().toLower() + ".pck"_L1)
-            {
-                m_engine = Engine::Godot;
-                return;
-            }
-        }
+        m_features.setFlag(Feature::Anticheat);
+        emit featuresChanged();
     }
 
-    // fall back to looking for a single data.pck file
-    QStringList pcks;
-    for (QDirIterator dirit{binaryDir, QDirIterator::Subdirectories}; dirit.hasNext();)
+    m_detectionPending = !result.engineDecided || !result.anticheatDecided;
+}
+
+void Game::cacheDetection(const QString &fingerprint, const DetectionResult &result)
+{
+    DetectionCache::Entry entry;
+    entry.fingerprint = fingerprint;
+    entry.engine = m_engine;
+    entry.anticheat = hasAnticheat();
+    entry.engineDecided = result.engineDecided;
+    entry.anticheatDecided = result.anticheatDecided;
+    for (const auto &exe : std::as_const(m_executables))
     {
-        const auto file = dirit.next();
-        if (file.endsWith(".pck"_L1, Qt::CaseInsensitive))
-            pcks.push_back(file);
+        if (exe.arch != Architecture::UnknownArch)
+            entry.architectures.insert(exe.executable, exe.arch);
     }
-    if (pcks.size() == 1 && pcks.first().endsWith("/data.pck"_L1, Qt::CaseInsensitive))
+    DetectionCache::instance()->insert(detectionKey(), std::move(entry));
+}
+
+QString Game::detectionKey() const
+{
+    return "%1/%2"_L1.arg(QMetaEnum::fromType<Store>().valueToKey(static_cast<int>(store())), m_id);
+}
+
+QString Game::installFingerprint() const
+{
+    return installFingerprint(m_installDir, m_installVersion, m_executables);
+}
+
+QString Game::installFingerprint(const QString &installDir, const QString &installVersion,
+                                 const QMap<int, LaunchOption> &executables)
+{
+    // If the store can tell us which version is installed, that's all we need. Otherwise, fall back to checking whether
+    // the install dir or any of the executables have been touched.
+    QString fingerprint;
+    if (installVersion.isEmpty())
+        fingerprint = "mtime:%1"_L1.arg(QFileInfo{installDir}.lastModified().toMSecsSinceEpoch());
+    else
+        fingerprint = "version:"_L1 + installVersion;
+
+    // Detection depends on which executables there are, which can change without the install changing
+    for (const auto &exe : executables)
     {
-        m_engine = Engine::Godot;
-        return;
+        fingerprint += "\n%1:%2"_L1.arg(static_cast<int>(exe.platform)).arg(exe.executable);
+        if (installVersion.isEmpty())
+        {
+            const QFileInfo fi{exe.executable};
+            fingerprint += ":%1:%2"_L1.arg(fi.size()).arg(fi.lastModified().toMSecsSinceEpoch());
+        }
     }
+    return fingerprint;
 }
 
 void Game::detectArchitectures()
 {
     for (auto &exe : m_executables)
     {
-        QFile raw{exe.executable};
-        if (raw.open(QFile::ReadOnly))
+        // TODO: some games (e.g. Portal 2) ship a .sh for the Linux launch option. I should come up with a generic
+        // solution eventually. For now, we hardcode it.
+        if (exe.platform == Platform::Linux && m_id == "620"_L1 && store() == Store::Steam &&
+            exe.executable.endsWith(".sh"_L1))
         {
-            if (exe.platform == Platform::Windows)
-            {
-                QDataStream ds(&raw);
-                ds.setByteOrder(QDataStream::LittleEndian);
-
-                // Verify DOS header (MZ signature)
-                raw.seek(0);
-                quint16 dosSig;
-                ds >> dosSig;
-                if (dosSig != 0x5A4D)
-                    continue;
-
-                // Read PE header offset
-                raw.seek(0x3C);
-                qint32 peOffset;
-                ds >> peOffset;
-
-                // Seek to PE header and verify signature
-                raw.seek(peOffset);
-                quint32 peSig;
-                ds >> peSig;
-                if (peSig != 0x00004550)
-                    continue;
-
-                // Read the Machine field (architecture)
-                quint16 machine;
-                ds >> machine;
-
-                // Determine architecture
-                switch (machine)
-                {
-                case 0x014C:
-                    exe.arch = Architecture::x86;
-                    break;
-                case 0x8664:
-                    exe.arch = Architecture::x64;
-                    break;
-                // In case we need to start dealing with Arm games:
-                // case 0xAA64:
-                //     // ARM64
-                //     break;
-                // case 0x01C0:
-                // case 0x01C4:
-                //     // ARM
-                //     break;
-                default:
-                    Aptabase::instance()->track(
-                        "unknown-pe-architecture-bug"_L1,
-                        {{"pe-arch"_L1, machine},
-                         {"game-id", m_id},
-                         {"executable", exe.executable},
-                         {"store", QMetaEnum::fromType<Store>().valueToKey(static_cast<quint64>(store()))}});
-                    break;
-                }
-            }
-            else if (exe.platform == Platform::Linux)
-            {
-                // TODO: some games (e.g. Portal 2) ship a .sh for the Linux launch option. I should come up with a generic
-                // solution eventually. For now, we hardcode it.
-                if (m_id == "620"_L1 && store() == Store::Steam && exe.executable.endsWith(".sh"_L1))
-                {
-                    // Portal 2 launches via shell script but has an x86 binary
-                    exe.arch = Architecture::x86;
-                    continue;
-                }
-
-                QDataStream ds(&raw);
-                ds.setByteOrder(QDataStream::LittleEndian); // Initial read is fixed
-
-                // Verify ELF magic number
-                raw.seek(0);
-                quint32 magic;
-                ds >> magic;
-                if (magic != 0x464C457F)
-                    continue;
-
-                // Read class (32/64 bit)
-                raw.seek(4);
-                quint8 elfClass;
-                ds >> elfClass;
-                if (elfClass != 1 && elfClass != 2)
-                    continue;
-
-                // Read data encoding (endianness)
-                quint8 data;
-                ds >> data;
-                if (data == 1)
-                    ds.setByteOrder(QDataStream::LittleEndian);
-                else if (data == 2)
-                    ds.setByteOrder(QDataStream::BigEndian);
-                else
-                    continue; // invalid encoding
-
-                // Skip to e_machine (offset 18)
-                raw.seek(18);
-                quint16 machine;
-                ds >> machine;
-
-                // Determine architecture
-                switch (machine)
-                {
-                case 3: // EM_386
-                    exe.arch = Architecture::x86;
-                    break;
-                case 62: // EM_X86_64
-                    exe.arch = Architecture::x64;
-                    break;
-                // If Deckard is what they say it is...
-                // case 183: // EM_AARCH64
-                //     // ARM64 (AARCH64)
-                //     break;
-                // case 40: // EM_ARM
-                //     // ARM
-                //     break;
-                default:
-                    Aptabase::instance()->track(
-                        "unknown-elf-architecture-bug"_L1,
-                        {{"elf-arch"_L1, machine},
-                         {"game-id", m_id},
-                         {"executable", exe.executable},
-                         {"store", QMetaEnum::fromType<Store>().valueToKey(static_cast<quint64>(store()))}});
-                    break;
-                }
-            }
+            // Portal 2 launches via shell script but has an x86 binary
+            exe.arch = Architecture::x86;
+            continue;
         }
-    }
-}
 
-void Game::detectAnticheat()
-{
-    // Rules from
-    // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/1e4ec6197ab40fcd3706e09166acaccc96f7e5d7/rules.ini#L238
-    static const QList<QRegularExpression> anticheats = {
-        QRegularExpression{R"((?:^|/)AntiCheatExpert/)"_L1},
-        QRegularExpression{R"((?:^|/)AceAntibotClient/)"_L1},
-        QRegularExpression{R"((?:^|/)anybrainSDK\.dll$)"_L1},
-        QRegularExpression{R"((?:^|/)BEService(?:_x64)?\.exe$)"_L1},
-        QRegularExpression{R"((?:^|/)BlackCall(?:64)?\.aes$)"_L1},
-        QRegularExpression{R"((?:^|/)BlackCat64\.sys$)"_L1},
-        QRegularExpression{R"((?:^|/)EasyAntiCheat_(?:EOS_)?Setup\.exe$)"_L1},
-        QRegularExpression{R"((?:^|/)(?:EasyAntiCheat(?:_x64)?|eac_server64)\.dll$)"_L1},
-        QRegularExpression{R"((?:^|/)EAAntiCheat\.Installer\.exe$)"_L1},
-        QRegularExpression{R"((?:^|/)equ8_conf\.json$)"_L1},
-        QRegularExpression{R"((?:^|/)FredaikisAntiCheat/)"_L1},
-        QRegularExpression{R"((?:^|/)HShield/HSInst\.dll$)"_L1},
-        QRegularExpression{R"((?:^|/)gameguard\.des$)"_L1},
-        QRegularExpression{R"((?:^|/)(?:PnkBstrA|pbsvc)\.exe$)"_L1},
-        QRegularExpression{R"((?:^|/)pbsv\.dll$)"_L1},
-        QRegularExpression{R"((?:^|/)Punkbuster(?:$|/))"_L1},
-        QRegularExpression{R"((?:^|/)Randgrid\.sys$)"_L1},
-        QRegularExpression{R"((?:^|/)TP3Helper\.exe$)"_L1},
-        QRegularExpression{R"(\.xem$)"_L1},
-    };
+        exe.binary = BinaryInfo::read(exe.executable);
 
-    for (QDirIterator gameDirIterator{m_installDir, QDirIterator::Subdirectories}; gameDirIterator.hasNext();)
-    {
-        auto localName = gameDirIterator.next().remove(m_installDir);
-        for (const auto &anticheat : anticheats)
+        if (exe.platform == Platform::Windows && exe.binary.format == BinaryInfo::Format::PE)
+        {
+            switch (exe.binary.machine)
+            {
+            case 0x014C:
+                exe.arch = Architecture::x86;
+                break;
+            case 0x8664:
+                exe.arch = Architecture::x64;
+                break;
+            // In case we need to start dealing with Arm games:
+            // case 0xAA64:
+            //     // ARM64
+            //     break;
+            // case 0x01C0:
+            // case 0x01C4:
+            //     // ARM
+            //     break;
+            default:
+                Aptabase::instance()->track(
+                    "unknown-pe-architecture-bug"_L1,
+                    {{"pe-arch"_L1, exe.binary.machine},
+                     {"game-id", m_id},
+                     {"executable", exe.executable},
+                     {"store", QMetaEnum::fromType<Store>().valueToKey(static_cast<quint64>(store()))}});
+                break;
+            }
+        }
+        else if (exe.platform == Platform::Linux && exe.binary.format == BinaryInfo::Format::ELF)
         {
-            if (localName.contains(anticheat))
+            switch (exe.binary.machine)
             {
-                m_features.setFlag(Feature::Anticheat);
-                return;
+            case 3: // EM_386
+                exe.arch = Architecture::x86;
+                break;
+            case 62: // EM_X86_64
+                exe.arch = Architecture::x64;
+                break;
+            // If Deckard is what they say it is...
+            // case 183: // EM_AARCH64
+            //     // ARM64 (AARCH64)
+            //     break;
+            // case 40: // EM_ARM
+            //     // ARM
+            //     break;
+            default:
+                Aptabase::instance()->track(
+                    "unknown-elf-architecture-bug"_L1,
+                    {{"elf-arch"_L1, exe.binary.machine},
+                     {"game-id", m_id},
+                     {"executable", exe.executable},
+                     {"store", QMetaEnum::fromType<Store>().valueToKey(static_cast<quint64>(store()))}});
+                break;
             }
         }
     }
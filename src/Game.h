@@ -3,6 +3,11 @@
 #include <QObject>
 #include <QQmlEngine>
 
+#include "BinaryInfo.h"
+
+struct DetectionBudget;
+struct DetectionResult;
+
 class Game : public QObject
 {
     Q_OBJECT
@@ -21,7 +26,8 @@ class Game : public QObject
     Q_PROPERTY(bool vrOnly READ vrOnly CONSTANT FINAL)
     Q_PROPERTY(bool hasMultiplePlatforms READ hasMultiplePlatforms CONSTANT FINAL)
     Q_PROPERTY(bool noWindowsSupport READ noWindowsSupport CONSTANT FINAL)
-    Q_PROPERTY(bool hasAnticheat READ hasAnticheat CONSTANT FINAL)
+    Q_PROPERTY(bool hasAnticheat READ hasAnticheat NOTIFY featuresChanged FINAL)
+    Q_PROPERTY(Engine engine READ engine NOTIFY engineChanged FINAL)
 
     Q_PROPERTY(QString cardImage READ cardImage CONSTANT)
     Q_PROPERTY(QString heroImage READ heroImage CONSTANT)
@@ -100,8 +106,8 @@ public:
     QString name() const { return m_name; }
     QString installDir() const { return m_installDir; }
     QDateTime lastPlayed() const { return m_lastPlayed; }
-    QString winePrefix() const { return m_winePrefix; }
-    QString wineBinary() const { return m_wineBinary; }
+    QString winePrefix() const;
+    QString wineBinary() const;
     Engine engine() const { return m_engine; }
     AppType type() const { return m_type; }
     Features features() const { return m_features; }
@@ -137,6 +143,9 @@ public:
         Platform platform;
         Architecture arch = Architecture::UnknownArch;
         QString executable;
+        // What the executable's headers say. Only filled in when detection actually looked at the binary, not when its
+        // results came from the cache.
+        BinaryInfo binary;
     };
 
     const QMap<int, LaunchOption> executables() const { return m_executables; }
@@ -146,25 +155,48 @@ public:
 
     Q_INVOKABLE bool hasValidWine() const;
 
+    // Works out the engine, anticheat and architectures. Stores have this run on the scan executor once the install dir
+    // and executables are known, before the game is added to the model. Results are cached until installFingerprint()
+    // changes. Whatever detection couldn't tell within its budget is left pending, and stays pending when it comes from
+    // the cache, so only finishDetection() ever has to walk the whole install.
+    void detect();
+    void detect(const DetectionBudget &budget);
+    // Whether detection gave up before it could tell the engine or anticheat apart, leaving the rest to finishDetection()
+    bool detectionPending() const { return m_detectionPending; }
+    // Finishes detection on the scan executor if it's still pending. engineChanged() and featuresChanged() are emitted
+    // if the answers change, then detectionFinished().
+    Q_INVOKABLE void finishDetection();
+
     Q_INVOKABLE virtual void launch() const = 0;
 
 signals:
     void winePrefixExistsChanged(bool state);
     void wineBinaryChanged(QString path);
+    void engineChanged(Game::Engine engine);
+    void featuresChanged();
+    void detectionFinished();
 
 protected:
     explicit Game(QObject *parent = nullptr);
 
-    void detectGameEngine();
     void detectArchitectures();
-    void detectAnticheat();
+    QString installFingerprint() const;
+    // Stats the install dir and executables unless there's a version, so keep it off the main thread
+    static QString installFingerprint(const QString &installDir, const QString &installVersion,
+                                      const QMap<int, LaunchOption> &executables);
 
     QString m_id;
     QString m_name;
     QString m_installDir;
+    // Whatever the store uses to tell installed versions of a game apart, e.g. Steam's build ID. Optional.
+    QString m_installVersion;
     QDateTime m_lastPlayed;
     QString m_winePrefix;
     QString m_wineBinary;
+    // For games that aren't tied to a particular Wine. Whichever of m_wineBinary and m_winePrefix is empty then falls back
+    // to the system's default, looked up whenever it's asked for: Steam and Heroic may only turn up a Proton to fall back
+    // on after the game was created.
+    bool m_defaultWine = false;
     AppType m_type = AppType::Other;
     Features m_features = Feature::Flatscreen;
 
@@ -188,7 +220,14 @@ protected:
     bool m_valid = false;
 
 private:
+    void applyDetection(const DetectionResult &result);
+    // Caches what was decided, along with the current architectures
+    void cacheDetection(const QString &fingerprint, const DetectionResult &result);
+    QString detectionKey() const;
+
     Engine m_engine = Engine::UnknownEngine;
+    bool m_detectionPending = false;
+    bool m_detectionRunning = false;
 };
 Q_DECLARE_METATYPE(Game)
 
@@ -0,0 +1,396 @@
+#include "GameDetector.h"
+
+#include <algorithm>
+#include <optional>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QLoggingCategory>
+
+#include "DirWalker.h"
+#include "PathMatcher.h"
+
+Q_LOGGING_CATEGORY(GameDetectorLog, "detector")
+
+namespace
+{
+    using Verdict = DetectionRule::Verdict;
+
+    // Some rules only care about the directory the game's binaries are in. prefix is that directory relative to the
+    // install dir, or empty if it's the install dir itself.
+    std::optional<QLatin1StringView> underPrefix(QLatin1StringView path, QLatin1StringView prefix)
+    {
+        if (prefix.isEmpty())
+            return path;
+        if (path.size() > prefix.size() && path.at(prefix.size()).toLatin1() == '/' && path.startsWith(prefix))
+            return path.sliced(prefix.size());
+        return std::nullopt;
+    }
+
+    enum PatternGroup : uint32_t
+    {
+        SourcePatterns = 1 << 0,
+        AnticheatPatterns = 1 << 1,
+    };
+
+    // Every SteamDB path rule we use boils down to literals that either appear anywhere in the path or end it. Paths always
+    // start with a slash, so "(?:^|/)" is just a leading slash. The rules are matched case sensitively, same as SteamDB.
+    const PathMatcher &pathMatcher()
+    {
+        using enum PathMatcher::Anchor;
+        static const PathMatcher matcher{{
+            // Source, from SteamDB
+            // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/ac27c7cfc0a63dc07cc9e65157841857d82f347b/rules.ini#L191
+            // (?:^|/)(?:vphysics|bsppack)\.(?:dylib|dll|so)$
+            {"/vphysics.dylib"_L1, End, SourcePatterns},
+            {"/vphysics.dll"_L1, End, SourcePatterns},
+            {"/vphysics.so"_L1, End, SourcePatterns},
+            {"/bsppack.dylib"_L1, End, SourcePatterns},
+            {"/bsppack.dll"_L1, End, SourcePatterns},
+            {"/bsppack.so"_L1, End, SourcePatterns},
+
+            // Anticheats, from SteamDB
+            // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/1e4ec6197ab40fcd3706e09166acaccc96f7e5d7/rules.ini#L238
+            {"/AntiCheatExpert/"_L1, Anywhere, AnticheatPatterns},
+            {"/AceAntibotClient/"_L1, Anywhere, AnticheatPatterns},
+            {"/anybrainSDK.dll"_L1, End, AnticheatPatterns},
+            // (?:^|/)BEService(?:_x64)?\.exe$
+            {"/BEService.exe"_L1, End, AnticheatPatterns},
+            {"/BEService_x64.exe"_L1, End, AnticheatPatterns},
+            // (?:^|/)BlackCall(?:64)?\.aes$
+            {"/BlackCall.aes"_L1, End, AnticheatPatterns},
+            {"/BlackCall64.aes"_L1, End, AnticheatPatterns},
+            {"/BlackCat64.sys"_L1, End, AnticheatPatterns},
+            // (?:^|/)EasyAntiCheat_(?:EOS_)?Setup\.exe$
+            {"/EasyAntiCheat_Setup.exe"_L1, End, AnticheatPatterns},
+            {"/EasyAntiCheat_EOS_Setup.exe"_L1, End, AnticheatPatterns},
+            // (?:^|/)(?:EasyAntiCheat(?:_x64)?|eac_server64)\.dll$
+            {"/EasyAntiCheat.dll"_L1, End, AnticheatPatterns},
+            {"/EasyAntiCheat_x64.dll"_L1, End, AnticheatPatterns},
+            {"/eac_server64.dll"_L1, End, AnticheatPatterns},
+            {"/EAAntiCheat.Installer.exe"_L1, End, AnticheatPatterns},
+            {"/equ8_conf.json"_L1, End, AnticheatPatterns},
+            {"/FredaikisAntiCheat/"_L1, Anywhere, AnticheatPatterns},
+            {"/HShield/HSInst.dll"_L1, End, AnticheatPatterns},
+            {"/gameguard.des"_L1, End, AnticheatPatterns},
+            // (?:^|/)(?:PnkBstrA|pbsvc)\.exe$
+            {"/PnkBstrA.exe"_L1, End, AnticheatPatterns},
+            {"/pbsvc.exe"_L1, End, AnticheatPatterns},
+            {"/pbsv.dll"_L1, End, AnticheatPatterns},
+            // (?:^|/)Punkbuster(?:$|/)
+            {"/Punkbuster"_L1, End, AnticheatPatterns},
+            {"/Punkbuster/"_L1, Anywhere, AnticheatPatterns},
+            {"/Randgrid.sys"_L1, End, AnticheatPatterns},
+            {"/TP3Helper.exe"_L1, End, AnticheatPatterns},
+            {".xem"_L1, End, AnticheatPatterns},
+        }};
+        return matcher;
+    }
+
+    // =======================================
+    // Unreal detection
+    //
+    // Detection method sourced from Rai Pal
+    // https://github.com/Raicuparta/rai-pal/blob/51157fdae6b1d87760580d85082ccd5026bb0320/backend/core/src/game_engines/unreal.rs
+    class UnrealRule : public DetectionRule
+    {
+    public:
+        explicit UnrealRule(const QString &binaryDir)
+            : m_binaryDir{binaryDir}
+        {}
+
+        Verdict probe() override
+        {
+            static const QList<QLatin1StringView> signsOfUnreal = {
+                "/Engine/Binaries/Win64"_L1,
+                "/Engine/Binaries/Win32"_L1,
+                "/Engine/Binaries/ThirdParty"_L1,
+            };
+            for (const auto sign : signsOfUnreal)
+                if (QFileInfo fi{m_binaryDir + sign}; fi.exists() && fi.isDir())
+                    return Verdict::Match;
+            return Verdict::NoMatch;
+        }
+
+    private:
+        QString m_binaryDir;
+    };
+
+    // =======================================
+    // Source detection
+    class SourceRule : public DetectionRule
+    {
+    public:
+        explicit SourceRule(const QString &binaryPrefix)
+            : m_binaryPrefix{binaryPrefix.toUtf8()}
+        {}
+
+        Verdict visit(const Entry &entry) override
+        {
+            // The patterns start at a slash that belongs to the file name, so a match on the full path is a match on the
+            // path under the binary dir too
+            if ((entry.patterns & SourcePatterns) && underPrefix(entry.path, QLatin1StringView{m_binaryPrefix}))
+                return Verdict::Match;
+            return Verdict::Undecided;
+        }
+
+    private:
+        QByteArray m_binaryPrefix; // UTF-8
+    };
+
+    // =======================================
+    // Unity detection
+    //
+    // Detection method sourced from Rai Pal
+    // https://github.com/Raicuparta/rai-pal/blob/51157fdae6b1d87760580d85082ccd5026bb0320/backend/core/src/game_engines/unity.rs
+    class UnityDataRule : public DetectionRule
+    {
+    public:
+        explicit UnityDataRule(const QMap<int, Game::LaunchOption> &executables)
+            : m_executables{executables}
+        {}
+
+        Verdict probe() override
+        {
+            for (const auto &e : std::as_const(m_executables))
+            {
+                QFileInfo exe{e.executable};
+                if (QFileInfo dataDir{exe.absolutePath() + '/' + exe.baseName() + "_Data"_L1};
+                    dataDir.exists() && dataDir.isDir())
+                    return Verdict::Match;
+            }
+            return Verdict::NoMatch;
+        }
+
+    private:
+        QMap<int, Game::LaunchOption> m_executables;
+    };
+
+    // Unity fallback: if the crash handler exists, it's a dead giveaway
+    class UnityCrashHandlerRule : public DetectionRule
+    {
+    public:
+        Verdict visit(const Entry &entry) override
+        {
+            if (entry.fileName == "UnityCrashHandler64.exe"_L1 || entry.fileName == "UnityCrashHandler32.exe"_L1)
+                return Verdict::Match;
+            return Verdict::Undecided;
+        }
+    };
+
+    // =======================================
+    // Godot detection
+    //
+    // Dectection method sourced from SteamDB
+    // https://github.com/SteamDatabase/FileDetectionRuleSets/blob/ac27c7cfc0a63dc07cc9e65157841857d82f347b/tests/FileDetector.php#L316
+    class GodotPckRule : public DetectionRule
+    {
+    public:
+        explicit GodotPckRule(const QMap<int, Game::LaunchOption> &executables)
+            : m_executables{executables}
+        {}
+
+        Verdict probe() override
+        {
+            // Only the executable's own directory needs looking at. Executable names can contain anything, so they're only
+            // ever compared, never used as a name filter.
+            for (const auto &e : std::as_const(m_executables))
+            {
+                const QFileInfo exe{e.executable};
+                const auto pck = exe.baseName() + ".pck"_L1;
+                if (QFileInfo::exists(exe.absolutePath() + '/' + pck))
+                    return Verdict::Match;
+
+                // The .pck doesn't have to match the executable's case
+                const auto pcks = QDir{exe.absolutePath()}.entryList({"*.pck"_L1}, QDir::AllEntries);
+                if (std::ranges::any_of(pcks,
+                                        [&pck](const QString &name) { return !name.compare(pck, Qt::CaseInsensitive); }))
+                    return Verdict::Match;
+            }
+            return Verdict::NoMatch;
+        }
+
+    private:
+        QMap<int, Game::LaunchOption> m_executables;
+    };
+
+    // Fall back to looking for a single data.pck file
+    class GodotDataPckRule : public DetectionRule
+    {
+    public:
+        explicit GodotDataPckRule(const QString &binaryPrefix)
+            : m_binaryPrefix{binaryPrefix.toUtf8()}
+        {}
+
+        Verdict visit(const Entry &entry) override
+        {
+            const auto local = underPrefix(entry.path, QLatin1StringView{m_binaryPrefix});
+            if (!local || !local->endsWith(".pck"_L1, Qt::CaseInsensitive))
+                return Verdict::Undecided;
+
+            // A second .pck settles it
+            if (++m_pcks > 1)
+                return Verdict::NoMatch;
+            m_isDataPck = local->endsWith("/data.pck"_L1, Qt::CaseInsensitive);
+            return Verdict::Undecided;
+        }
+
+        Verdict finish() override { return m_pcks == 1 && m_isDataPck ? Verdict::Match : Verdict::NoMatch; }
+
+    private:
+        QByteArray m_binaryPrefix; // UTF-8
+        int m_pcks = 0;
+        bool m_isDataPck = false;
+    };
+
+    // =======================================
+    // Anticheat detection
+    class AnticheatRule : public DetectionRule
+    {
+    public:
+        Verdict visit(const Entry &entry) override
+        {
+            return entry.patterns & AnticheatPatterns ? Verdict::Match : Verdict::Undecided;
+        }
+    };
+} // namespace
+
+GameDetector::GameDetector(const QString &installDir, const QMap<int, Game::LaunchOption> &executables)
+    : m_installDir{installDir}
+{
+    QString binaryDir{m_installDir};
+    for (const auto &exe : executables)
+    {
+        if (QFileInfo fi{exe.executable}; fi.absolutePath() != m_installDir)
+        {
+            binaryDir = fi.absolutePath();
+            break;
+        }
+    }
+
+    // Only the install dir gets walked, so if the binaries live somewhere else entirely, look at the whole install instead
+    const auto binaryPrefix = binaryDir.startsWith(m_installDir + '/') ? binaryDir.sliced(m_installDir.size()) : QString{};
+
+    addRule(Question::Engine, Game::Unreal, std::make_unique<UnrealRule>(binaryDir));
+    addRule(Question::Engine, Game::Source, std::make_unique<SourceRule>(binaryPrefix));
+    addRule(Question::Engine, Game::Unity, std::make_unique<UnityDataRule>(executables));
+    addRule(Question::Engine, Game::Unity, std::make_unique<UnityCrashHandlerRule>());
+    addRule(Question::Engine, Game::Godot, std::make_unique<GodotPckRule>(executables));
+    addRule(Question::Engine, Game::Godot, std::make_unique<GodotDataPckRule>(binaryPrefix));
+
+    addRule(Question::Anticheat, Game::UnknownEngine, std::make_unique<AnticheatRule>());
+}
+
+DetectionResult GameDetector::detect(bool findAnticheat, const DetectionBudget &budget)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!findAnticheat)
+        std::erase_if(m_slots, [](const Slot &slot) { return slot.question == Question::Anticheat; });
+
+    qsizetype walked = 0;
+    bool truncated = false;
+    for (auto &slot : m_slots)
+    {
+        if (budget.exhausted())
+        {
+            truncated = true;
+            break;
+        }
+        slot.verdict = slot.rule->probe();
+        slot.decisive = slot.verdict == Verdict::Match;
+    }
+
+    if (!refresh() && !truncated && !m_installDir.isEmpty())
+    {
+        for (DirWalker it{m_installDir}; it.next();)
+        {
+            if ((budget.maxEntries >= 0 && walked >= budget.maxEntries) || budget.exhausted())
+            {
+                truncated = true;
+                break;
+            }
+            ++walked;
+
+            DetectionRule::Entry entry;
+            entry.path = QLatin1StringView{it.path().data(), static_cast<qsizetype>(it.path().size())};
+            entry.fileName = QLatin1StringView{it.fileName().data(), static_cast<qsizetype>(it.fileName().size())};
+            entry.patterns = pathMatcher().match(entry.path);
+
+            bool changed = false;
+            for (auto &slot : m_slots)
+            {
+                if (!slot.live)
+                    continue;
+                slot.verdict = slot.rule->visit(entry);
+                changed = changed || slot.verdict != Verdict::Undecided;
+            }
+
+            if (changed && refresh())
+                break;
+        }
+    }
+
+    // Rules can only be sure that something isn't there if they've seen everything. Rules that lost their say never saw
+    // the walk at all.
+    if (!truncated)
+        for (auto &slot : m_slots)
+            if (slot.live)
+                slot.verdict = slot.rule->finish();
+    refresh();
+
+    DetectionResult result;
+    result.engineDecided = isDecided(Question::Engine);
+    result.anticheatDecided = isDecided(Question::Anticheat);
+    for (const auto &slot : m_slots)
+    {
+        if (slot.verdict != Verdict::Match)
+            continue;
+        if (slot.question == Question::Engine && result.engineDecided && result.engine == Game::UnknownEngine)
+            result.engine = slot.engine;
+        else if (slot.question == Question::Anticheat && result.anticheatDecided)
+            result.anticheat = true;
+    }
+
+    qCDebug(GameDetectorLog) << "Walked" << walked << "entries of" << m_installDir << "in" << timer.elapsed()
+                             << "ms. Engine:" << result.engine << "decided:" << result.engineDecided
+                             << "anticheat:" << result.anticheat << "decided:" << result.anticheatDecided;
+    return result;
+}
+
+void GameDetector::addRule(Question question, Game::Engine engine, std::unique_ptr<DetectionRule> rule)
+{
+    m_slots.push_back({question, engine, std::move(rule)});
+}
+
+bool GameDetector::refresh()
+{
+    bool done = true;
+    for (const auto question : {Question::Engine, Question::Anticheat})
+    {
+        // A probe that matched settles it, and otherwise nothing ranked below a match can change the answer. Without the
+        // former, a big install would leave e.g. a Unity game with a _Data dir undecided while the Source rule, which is
+        // ranked higher, waits for a walk that runs out of budget.
+        const bool settled = std::ranges::any_of(
+            m_slots, [question](const Slot &slot) { return slot.question == question && slot.decisive; });
+        bool matched = false;
+        for (auto &slot : m_slots)
+        {
+            if (slot.question != question)
+                continue;
+            slot.live = !settled && !matched && slot.verdict == Verdict::Undecided;
+            done = done && !slot.live;
+            matched = matched || slot.verdict == Verdict::Match;
+        }
+    }
+    return done;
+}
+
+bool GameDetector::isDecided(Question question) const
+{
+    return std::none_of(m_slots.begin(), m_slots.end(), [question](const Slot &slot) {
+        return slot.question == question && slot.live;
+    });
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <QDeadlineTimer>
+#include <QLatin1StringView>
+#include <QMap>
+#include <QString>
+
+#include "Game.h"
+
+// A single check that tells us something about a game from the files in its install dir
+class DetectionRule
+{
+public:
+    enum class Verdict
+    {
+        Undecided,
+        Match,
+        NoMatch,
+    };
+
+    // Names are UTF-8, viewed as Latin-1. Everything the rules look for is ASCII, which is the same either way.
+    struct Entry
+    {
+        QLatin1StringView path; // Relative to the install dir, starting with a slash
+        QLatin1StringView fileName;
+        uint32_t patterns = 0; // Groups of path patterns found in the path
+    };
+
+    virtual ~DetectionRule() = default;
+
+    // Called before the install dir is walked. Rules that only need to look at a few known paths should decide here. A
+    // match found here is decisive: it settles the question without waiting on higher ranked rules that need the walk.
+    virtual Verdict probe() { return Verdict::Undecided; }
+    // Called for every file and directory in the install dir for as long as the rule is undecided
+    virtual Verdict visit(const Entry &entry) { return Verdict::Undecided; }
+    // Called once the walk is over for rules that are still undecided
+    virtual Verdict finish() { return Verdict::NoMatch; }
+};
+
+struct DetectionResult
+{
+    Game::Engine engine = Game::UnknownEngine;
+    bool anticheat = false;
+    // Whether the walk got far enough to answer each question. Undecided answers are left at their defaults.
+    bool engineDecided = true;
+    bool anticheatDecided = true;
+};
+
+// How much work detection may do. Anything that hasn't been decided once the budget runs out is reported as undecided.
+struct DetectionBudget
+{
+    // The walk gives up after this many entries, unless it's negative
+    qsizetype maxEntries = -1;
+    QDeadlineTimer deadline{QDeadlineTimer::Forever};
+    // Set from another thread to make detection stop as soon as it can
+    const std::atomic_bool *cancelled = nullptr;
+
+    bool exhausted() const { return (cancelled && cancelled->load(std::memory_order_relaxed)) || deadline.hasExpired(); }
+};
+
+// Works out a game's engine and whether it ships an anticheat with a single walk of its install dir. Every rule is fed
+// each entry of the walk, and the walk stops as soon as every question has been answered.
+class GameDetector
+{
+public:
+    GameDetector(const QString &installDir, const QMap<int, Game::LaunchOption> &executables);
+
+    // Set findAnticheat to false if the answer is already known, e.g. because the store told us
+    DetectionResult detect(bool findAnticheat = true, const DetectionBudget &budget = {});
+
+private:
+    enum class Question
+    {
+        Engine,
+        Anticheat,
+    };
+
+    struct Slot
+    {
+        Question question;
+        Game::Engine engine; // What a match means, for engine rules
+        std::unique_ptr<DetectionRule> rule;
+        DetectionRule::Verdict verdict = DetectionRule::Verdict::Undecided;
+        bool decisive = false; // Matched when probed
+        bool live = true;
+    };
+
+    // Rules for the same question are ranked in the order they're added; the highest ranked rule that matches wins, unless
+    // a probe has already matched
+    void addRule(Question question, Game::Engine engine, std::unique_ptr<DetectionRule> rule);
+    // Works out which rules still have a say in the outcome. Returns true once none do.
+    bool refresh();
+    bool isDecided(Question question) const;
+
+    QString m_installDir;
+    std::vector<Slot> m_slots;
+};
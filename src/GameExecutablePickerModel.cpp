@@ -9,6 +9,13 @@ GameExecutablePickerModel::GameExecutablePickerModel(Mod *mod, Game *game, std::
       m_callback{callback}
 {
     m_availableLaunchOptions = m_mod->acceptableInstallCandidates(game);
+
+    // Detection may still be finishing, and the engine decides which executables the mod can go on
+    connect(m_game, &Game::engineChanged, this, [this] {
+        beginResetModel();
+        m_availableLaunchOptions = m_mod->acceptableInstallCandidates(m_game);
+        endResetModel();
+    });
 }
 
 int GameExecutablePickerModel::rowCount(const QModelIndex &parent) const
@@ -1,6 +1,7 @@
 #include "GamesFilterModel.h"
 
 #include <QSettings>
+#include <QTimer>
 
 #include "Aptabase.h"
 
@@ -28,6 +29,16 @@ GamesFilterModel::GamesFilterModel(QObject *parent)
     setDynamicSortFilter(true);
     sort(0);
 
+    // Detection that was left pending only needs finishing once the filter can tell the difference. Filtering itself must
+    // not kick it off, since that happens far too often and on whatever rows the view asks about.
+    const auto filterChanged = [this] { finishDetection(0, m_models->rowCount() - 1); };
+    connect(this, &GamesFilterModel::engineFilterChanged, this, filterChanged);
+    connect(this, &GamesFilterModel::featureFilterChanged, this, filterChanged);
+    connect(this, &GamesFilterModel::featureFilterTypeChanged, this, filterChanged);
+    connect(m_models, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        finishDetection(first, last);
+    });
+
     QSettings settings;
     settings.beginGroup("GamesFilterModel"_L1);
     m_viewType = settings.value("viewType"_L1, ViewType::Grid).value<ViewType>();
@@ -145,6 +156,7 @@ bool GamesFilterModel::filterAcceptsRow(int row, const QModelIndex &parent) cons
     const auto g = sourceModel()->data(sourceModel()->index(row, 0, parent), Store::Roles::GameObject).value<Game *>();
     if (!g || !g->isValid())
         return false;
+
     if (!m_engineFilter.testFlag(g->engine()))
         return false;
     if (!m_typeFilter.testFlag(g->type()))
@@ -169,6 +181,43 @@ bool GamesFilterModel::filterAcceptsRow(int row, const QModelIndex &parent) cons
     return QSortFilterProxyModel::filterAcceptsRow(row, parent);
 }
 
+bool GamesFilterModel::filterNeedsDetection() const
+{
+    // Finishing detection means walking entire installs, so only do it if the answer can change which games are shown
+    constexpr Game::Engines allEngines{Game::UnknownEngine | Game::Unreal | Game::Unity | Game::Godot | Game::Source};
+    return m_engineFilter != allEngines || m_featureFilter.testFlag(Game::Feature::Anticheat);
+}
+
+void GamesFilterModel::finishDetection(int first, int last)
+{
+    if (!filterNeedsDetection())
+        return;
+
+    for (int row = first; row <= last; ++row)
+    {
+        const auto g = m_models->index(row, 0).data(Store::Roles::GameObject).value<Game *>();
+        if (!g || !g->detectionPending())
+            continue;
+
+        connect(g, &Game::detectionFinished, this, &GamesFilterModel::queueRefilter, Qt::UniqueConnection);
+        g->finishDetection();
+    }
+}
+
+void GamesFilterModel::queueRefilter()
+{
+    if (m_refilterQueued)
+        return;
+    m_refilterQueued = true;
+
+    // Detection tends to finish for lots of games in quick succession, so only filter once per batch
+    QTimer::singleShot(0, this, [this] {
+        m_refilterQueued = false;
+        beginFilterChange();
+        endFilterChange();
+    });
+}
+
 bool GamesFilterModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
 {
     const auto leftGame = sourceModel()->data(left, Store::Roles::GameObject).value<Game *>();
@@ -95,6 +95,13 @@ private:
     explicit GamesFilterModel(QObject *parent = nullptr);
     ~GamesFilterModel() = default;
 
+    bool filterNeedsDetection() const;
+    // Finishes detection for any games in the given rows of m_models that are still pending, if the filter depends on it.
+    // Games are filtered by whatever they were detected as so far until then.
+    void finishDetection(int first, int last);
+    // Filters every row again once the current batch of detection results is in
+    void queueRefilter();
+
     QConcatenateTablesProxyModel *m_models;
 
     Game::Engines m_engineFilter;
@@ -106,4 +113,6 @@ private:
     SortType m_sortType;
 
     FilterType m_featureFilterType = FilterType::HasAnyFilter;
+
+    bool m_refilterQueued = false;
 };
@@ -0,0 +1,353 @@
+#include "JsonView.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    bool isWhitespace(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+    }
+
+    qsizetype skipWhitespace(QByteArrayView data, qsizetype pos)
+    {
+        while (pos < data.size() && isWhitespace(data[pos]))
+            ++pos;
+        return pos;
+    }
+
+    // pos is at the opening quote. Returns where the closing quote is, or -1.
+    qsizetype findStringEnd(QByteArrayView data, qsizetype pos)
+    {
+        // Most strings have nothing escaped, so look for the quote first and only then for escapes in front of it
+        ++pos;
+        auto quote = data.indexOf('"', pos);
+        while (quote >= 0)
+        {
+            const auto escape = data.first(quote).indexOf('\\', pos);
+            if (escape < 0)
+                return quote;
+            pos = escape + 2;
+            if (pos > quote)
+                quote = data.indexOf('"', pos);
+        }
+        return -1;
+    }
+
+    // Returns the position just past the value starting at pos, or -1 if it doesn't end
+    qsizetype skipValue(QByteArrayView data, qsizetype pos)
+    {
+        if (pos >= data.size())
+            return -1;
+
+        switch (data[pos])
+        {
+        case '"':
+        {
+            const auto end = findStringEnd(data, pos);
+            return end < 0 ? -1 : end + 1;
+        }
+        case '{':
+        case '[':
+        {
+            // Only the nesting matters here, and brackets inside strings don't count
+            int depth = 0;
+            for (; pos < data.size(); ++pos)
+            {
+                switch (data[pos])
+                {
+                case '"':
+                    pos = findStringEnd(data, pos);
+                    if (pos < 0)
+                        return -1;
+                    break;
+                case '{':
+                case '[':
+                    ++depth;
+                    break;
+                case '}':
+                case ']':
+                    if (--depth == 0)
+                        return pos + 1;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return -1;
+        }
+        default:
+            // Numbers, true, false and null run until whatever comes after them
+            while (pos < data.size() && !isWhitespace(data[pos]) && data[pos] != ',' && data[pos] != '}' &&
+                   data[pos] != ']')
+                ++pos;
+            return pos;
+        }
+    }
+
+    // Reads the separator after a member or element at pos. Returns where the next one starts, or -1 at the end.
+    qsizetype nextItem(QByteArrayView data, qsizetype pos)
+    {
+        if (pos < 0)
+            return -1;
+        pos = skipWhitespace(data, pos);
+        if (pos >= data.size() || data[pos] != ',')
+            return -1;
+        return skipWhitespace(data, pos + 1);
+    }
+
+    int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // Decodes the inside of a string, without its quotes
+    QString decodeString(QByteArrayView contents)
+    {
+        auto escape = contents.indexOf('\\');
+        if (escape < 0)
+            return QString::fromUtf8(contents);
+
+        QString result;
+        result.reserve(contents.size());
+        qsizetype pos = 0;
+        while (escape >= 0 && escape + 1 < contents.size())
+        {
+            result += QString::fromUtf8(contents.sliced(pos, escape - pos));
+            pos = escape + 2;
+
+            switch (const auto c = contents[escape + 1])
+            {
+            case 'b':
+                result += '\b';
+                break;
+            case 'f':
+                result += '\f';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            case 'u':
+            {
+                // Surrogate pairs come as two escapes in a row, which end up next to each other here too
+                char16_t unit = 0;
+                for (qsizetype i = pos; i < pos + 4 && i < contents.size(); ++i)
+                    unit = unit * 16 + std::max(hexValue(contents[i]), 0);
+                result += QChar{unit};
+                pos = std::min(pos + 4, contents.size());
+                break;
+            }
+            default:
+                result += QLatin1Char{c};
+                break;
+            }
+
+            escape = contents.indexOf('\\', pos);
+        }
+
+        result += QString::fromUtf8(contents.sliced(std::min(pos, contents.size())));
+        return result;
+    }
+
+    // Whether the inside of a string spells key, without decoding it unless it has to
+    bool stringEquals(QByteArrayView contents, QByteArrayView utf8Key)
+    {
+        if (!contents.contains('\\'))
+            return contents == utf8Key;
+        return decodeString(contents) == QString::fromUtf8(utf8Key);
+    }
+} // namespace
+
+JsonView::Iterator::Iterator(QByteArrayView data, bool object)
+    : m_data{data}
+    , m_object{object}
+{
+    read(skipWhitespace(m_data, 1));
+}
+
+QString JsonView::Iterator::key() const
+{
+    if (!m_object || m_key < 0)
+        return {};
+    return decodeString(m_data.sliced(m_key + 1, findStringEnd(m_data, m_key) - m_key - 1));
+}
+
+JsonView::Iterator &JsonView::Iterator::operator++()
+{
+    if (m_value >= 0)
+        read(nextItem(m_data, skipValue(m_data, m_value)));
+    return *this;
+}
+
+void JsonView::Iterator::read(qsizetype pos)
+{
+    m_key = -1;
+    m_value = -1;
+    if (pos < 0 || pos >= m_data.size())
+        return;
+
+    if (!m_object)
+    {
+        if (m_data[pos] != ']')
+            m_value = pos;
+        return;
+    }
+
+    if (m_data[pos] != '"')
+        return;
+    const auto keyEnd = findStringEnd(m_data, pos);
+    if (keyEnd < 0)
+        return;
+    const auto colon = skipWhitespace(m_data, keyEnd + 1);
+    if (colon >= m_data.size() || m_data[colon] != ':')
+        return;
+
+    m_key = pos;
+    m_value = skipWhitespace(m_data, colon + 1);
+    if (m_value >= m_data.size())
+        m_value = -1;
+}
+
+JsonView::JsonView(QByteArrayView json)
+    : m_data{json.sliced(skipWhitespace(json, 0))}
+{}
+
+JsonView::Type JsonView::type() const
+{
+    if (m_data.isEmpty())
+        return Type::Undefined;
+
+    switch (m_data[0])
+    {
+    case '{':
+        return Type::Object;
+    case '[':
+        return Type::Array;
+    case '"':
+        return Type::String;
+    case 't':
+    case 'f':
+        return Type::Bool;
+    case 'n':
+        return Type::Null;
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+        return Type::Number;
+    default:
+        return Type::Undefined;
+    }
+}
+
+QString JsonView::toString(const QString &defaultValue) const
+{
+    if (!isString())
+        return defaultValue;
+    const auto end = findStringEnd(m_data, 0);
+    if (end < 0)
+        return defaultValue;
+    return decodeString(m_data.sliced(1, end - 1));
+}
+
+bool JsonView::toBool(bool defaultValue) const
+{
+    const auto value = raw();
+    if (value == "true")
+        return true;
+    if (value == "false")
+        return false;
+    return defaultValue;
+}
+
+double JsonView::toDouble(double defaultValue) const
+{
+    if (!isDouble())
+        return defaultValue;
+    bool ok = false;
+    const auto value = raw().toDouble(&ok);
+    return ok ? value : defaultValue;
+}
+
+int JsonView::toInt(int defaultValue) const
+{
+    // Like QJsonValue, only numbers that are whole and fit count
+    const auto value = toDouble(std::numeric_limits<double>::quiet_NaN());
+    if (std::trunc(value) != value || value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max())
+        return defaultValue;
+    return static_cast<int>(value);
+}
+
+QByteArrayView JsonView::raw() const
+{
+    const auto end = skipValue(m_data, 0);
+    return end < 0 ? QByteArrayView{} : m_data.first(end);
+}
+
+JsonView JsonView::operator[](QLatin1StringView key) const
+{
+    // ASCII is the same in Latin-1 and UTF-8, which covers every key anyone actually writes
+    if (std::any_of(key.begin(), key.end(), [](char c) { return static_cast<uchar>(c) >= 0x80; }))
+        return (*this)[QString{key}];
+    return member({key.data(), key.size()});
+}
+
+JsonView JsonView::operator[](const QString &key) const
+{
+    return member(key.toUtf8());
+}
+
+JsonView JsonView::operator[](qsizetype index) const
+{
+    if (!isArray() || index < 0)
+        return {};
+
+    for (auto it = begin(); it != end(); ++it)
+    {
+        if (index-- == 0)
+            return it.value();
+    }
+    return {};
+}
+
+JsonView JsonView::member(QByteArrayView utf8Key) const
+{
+    if (!isObject())
+        return {};
+
+    for (auto it = begin(); it != end(); ++it)
+    {
+        const auto keyEnd = findStringEnd(it.m_data, it.m_key);
+        if (stringEquals(it.m_data.sliced(it.m_key + 1, keyEnd - it.m_key - 1), utf8Key))
+            return it.value();
+    }
+    return {};
+}
+
+JsonView::Iterator JsonView::begin() const
+{
+    if (const auto t = type(); t == Type::Object || t == Type::Array)
+        return Iterator{m_data, t == Type::Object};
+    return {};
+}
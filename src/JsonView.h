@@ -0,0 +1,106 @@
+#pragma once
+
+#include <iterator>
+
+#include <QByteArrayView>
+#include <QLatin1StringView>
+#include <QString>
+
+// A read-only view of a JSON value that only decodes what gets asked for, straight from the raw bytes. Nothing is parsed
+// up front; looking up a member skips over the members before it without decoding them, so pulling a handful of fields
+// out of a multi-megabyte store file costs a fraction of building a QJsonDocument for it.
+//
+// Anything that isn't there, including anything past a syntax error, comes back as an undefined view, so lookups can be
+// chained like json["game"_L1]["logo"_L1].toString() without checking in between. Like QByteArrayView, a view doesn't
+// own its bytes and must not outlive them.
+class JsonView
+{
+public:
+    enum class Type
+    {
+        Undefined,
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    // Walks the elements of an array, or the members of an object
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = JsonView;
+        using difference_type = qsizetype;
+
+        Iterator() = default;
+
+        // The member's name. Empty for array elements.
+        QString key() const;
+        JsonView value() const { return JsonView{m_data.sliced(m_value)}; }
+        JsonView operator*() const { return value(); }
+
+        Iterator &operator++();
+        Iterator operator++(int)
+        {
+            auto it = *this;
+            ++*this;
+            return it;
+        }
+
+        bool operator==(const Iterator &other) const { return m_value == other.m_value; }
+        bool operator==(std::default_sentinel_t) const { return m_value < 0; }
+
+    private:
+        friend class JsonView;
+
+        Iterator(QByteArrayView data, bool object);
+
+        // Reads the member or element at pos, or becomes the end if there isn't one
+        void read(qsizetype pos);
+
+        QByteArrayView m_data;
+        bool m_object = false;
+        qsizetype m_key = -1;
+        qsizetype m_value = -1;
+    };
+
+    JsonView() = default;
+    // A view of the value at the start of json, which may be followed by anything
+    explicit JsonView(QByteArrayView json);
+
+    Type type() const;
+    bool isUndefined() const { return type() == Type::Undefined; }
+    bool isNull() const { return type() == Type::Null; }
+    bool isBool() const { return type() == Type::Bool; }
+    bool isDouble() const { return type() == Type::Number; }
+    bool isString() const { return type() == Type::String; }
+    bool isArray() const { return type() == Type::Array; }
+    bool isObject() const { return type() == Type::Object; }
+
+    QString toString(const QString &defaultValue = {}) const;
+    bool toBool(bool defaultValue = false) const;
+    double toDouble(double defaultValue = 0) const;
+    int toInt(int defaultValue = 0) const;
+
+    // The value's own bytes, e.g. to keep a copy of just this part of a document around
+    QByteArrayView raw() const;
+
+    // Member lookup for objects. Members are looked at in order, and the first one with the key wins.
+    JsonView operator[](QLatin1StringView key) const;
+    JsonView operator[](const QString &key) const;
+    // Element lookup for arrays
+    JsonView operator[](qsizetype index) const;
+
+    // Empty unless this is an array or an object
+    Iterator begin() const;
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    JsonView member(QByteArrayView utf8Key) const;
+
+    // Starts at the first byte of the value and runs to the end of the document
+    QByteArrayView m_data;
+};
@@ -0,0 +1,134 @@
+#include "KnownGames.h"
+
+#include <string_view>
+
+#include <QLoggingCategory>
+#include <QStandardPaths>
+#include <QtEndian>
+
+Q_LOGGING_CATEGORY(KnownGamesLog, "detector.known")
+
+namespace
+{
+    constexpr quint32 DATABASE_MAGIC = 0x44474B4B; // "KKGD"
+    constexpr quint32 DATABASE_VERSION = 1;
+    constexpr qint64 HEADER_SIZE = 16;
+    constexpr qint64 RECORD_SIZE = 12;
+
+    std::string_view view(QByteArrayView bytes)
+    {
+        return {bytes.data(), static_cast<size_t>(bytes.size())};
+    }
+
+    Game::Engine toEngine(uchar value)
+    {
+        if (QMetaEnum::fromType<Game::Engine>().valueToKey(value))
+            return static_cast<Game::Engine>(value);
+        return Game::UnknownEngine;
+    }
+
+    Game::Architecture toArchitecture(uchar value)
+    {
+        switch (value)
+        {
+        case static_cast<uchar>(Game::Architecture::x86):
+            return Game::Architecture::x86;
+        case static_cast<uchar>(Game::Architecture::x64):
+            return Game::Architecture::x64;
+        default:
+            return Game::Architecture::UnknownArch;
+        }
+    }
+} // namespace
+
+KnownGames::KnownGames()
+{
+    const auto path = QStandardPaths::locate(QStandardPaths::AppDataLocation, "known_games.db"_L1);
+    if (path.isEmpty())
+    {
+        qCDebug(KnownGamesLog) << "No known games database installed";
+        return;
+    }
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < HEADER_SIZE)
+    {
+        qCWarning(KnownGamesLog) << "Failed to open known games database" << path;
+        return;
+    }
+
+    const auto data = m_file.map(0, m_file.size());
+    if (!data)
+    {
+        qCWarning(KnownGamesLog) << "Failed to map known games database" << path;
+        return;
+    }
+
+    const auto magic = qFromLittleEndian<quint32>(data);
+    const auto version = qFromLittleEndian<quint32>(data + 4);
+    const auto count = qFromLittleEndian<quint32>(data + 8);
+    const auto stringsSize = qFromLittleEndian<quint32>(data + 12);
+    if (magic != DATABASE_MAGIC || version != DATABASE_VERSION)
+    {
+        qCInfo(KnownGamesLog) << "Ignoring known games database with unknown format" << Qt::hex << magic << version;
+        return;
+    }
+    if (HEADER_SIZE + count * RECORD_SIZE + stringsSize > m_file.size())
+    {
+        qCWarning(KnownGamesLog) << "Known games database is truncated" << path;
+        return;
+    }
+
+    m_records = data + HEADER_SIZE;
+    m_strings = m_records + count * RECORD_SIZE;
+    m_count = count;
+    m_stringsSize = stringsSize;
+    qCDebug(KnownGamesLog) << "Loaded" << m_count << "known games from" << path;
+}
+
+KnownGames *KnownGames::instance()
+{
+    static auto k = new KnownGames;
+    return k;
+}
+
+std::optional<KnownGames::Entry> KnownGames::find(const QString &key) const
+{
+    if (m_count == 0)
+        return std::nullopt;
+
+    const auto needle = key.toUtf8();
+    quint32 low = 0;
+    quint32 high = m_count;
+    while (low < high)
+    {
+        const auto mid = low + (high - low) / 2;
+        const auto order = view(keyAt(mid)).compare(view(needle));
+        if (order < 0)
+            low = mid + 1;
+        else if (order > 0)
+            high = mid;
+        else
+        {
+            const auto record = m_records + mid * RECORD_SIZE;
+            Entry entry;
+            entry.engine = toEngine(record[6]);
+            entry.anticheat = record[7] & 1;
+            entry.windowsArch = toArchitecture(record[8]);
+            entry.linuxArch = toArchitecture(record[9]);
+            return entry;
+        }
+    }
+
+    return std::nullopt;
+}
+
+QByteArrayView KnownGames::keyAt(quint32 index) const
+{
+    const auto record = m_records + index * RECORD_SIZE;
+    const auto offset = qFromLittleEndian<quint32>(record);
+    const auto length = qFromLittleEndian<quint16>(record + 4);
+    if (static_cast<qint64>(offset) + length > m_stringsSize)
+        return {};
+    return {m_strings + offset, length};
+}
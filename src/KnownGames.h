@@ -0,0 +1,47 @@
+#pragma once
+
+#include <optional>
+
+#include <QFile>
+#include <QString>
+
+#include "Game.h"
+
+// An optional database of games whose engine, anticheat and architecture are already known, so that they never need their
+// install looked at. It's a sorted table in a binary file that gets mapped into memory once and binary searched.
+//
+// The file is known_games.db in any of the app data locations. It's generated from data/known_games.json by
+// tools/generate_known_games.py at build time and installed with Kaon. Its layout, all little endian:
+//   header:  u32 magic ("KKGD"), u32 version, u32 record count, u32 size of the string table
+//   records: 12 bytes each, sorted by key bytes
+//              u32 key offset into the string table, u16 key length,
+//              u8 engine (a Game::Engine value), u8 flags (bit 0: anticheat),
+//              u8 Windows architecture, u8 Linux architecture (Game::Architecture values), u16 reserved
+//   strings: the keys, UTF-8. Keys look like DetectionCache keys, e.g. "Steam/620" or "Heroic/<Epic app name>".
+class KnownGames
+{
+public:
+    struct Entry
+    {
+        Game::Engine engine = Game::UnknownEngine;
+        bool anticheat = false;
+        Game::Architecture windowsArch = Game::Architecture::UnknownArch;
+        Game::Architecture linuxArch = Game::Architecture::UnknownArch;
+    };
+
+    static KnownGames *instance();
+
+    // Safe to call from any thread
+    std::optional<Entry> find(const QString &key) const;
+
+private:
+    KnownGames();
+
+    QByteArrayView keyAt(quint32 index) const;
+
+    QFile m_file;
+    const uchar *m_records = nullptr;
+    const uchar *m_strings = nullptr;
+    quint32 m_count = 0;
+    quint32 m_stringsSize = 0;
+};
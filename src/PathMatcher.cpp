@@ -0,0 +1,92 @@
+#include "PathMatcher.h"
+
+#include <limits>
+#include <queue>
+
+PathMatcher::PathMatcher(const QList<Pattern> &patterns)
+{
+    for (const auto &pattern : patterns)
+    {
+        for (const auto ch : pattern.text)
+        {
+            Q_ASSERT(static_cast<uint8_t>(ch) < m_classes.size());
+            if (m_classes[static_cast<uint8_t>(ch)] == 0)
+                m_classes[static_cast<uint8_t>(ch)] = m_classCount++;
+        }
+    }
+
+    // Build the trie. -1 marks a transition that doesn't exist yet.
+    std::vector<int> next(m_classCount, -1);
+    m_states.emplace_back();
+    for (const auto &pattern : patterns)
+    {
+        int state = 0;
+        for (const auto ch : pattern.text)
+        {
+            auto &to = next[state * m_classCount + m_classes[static_cast<uint8_t>(ch)]];
+            if (to < 0)
+            {
+                to = static_cast<int>(m_states.size());
+                m_states.emplace_back();
+                next.resize(m_states.size() * m_classCount, -1);
+            }
+            state = next[state * m_classCount + m_classes[static_cast<uint8_t>(ch)]];
+        }
+
+        if (pattern.anchor == Anchor::End)
+            m_states[state].atEnd |= pattern.group;
+        else
+            m_states[state].anywhere |= pattern.group;
+    }
+    Q_ASSERT(m_states.size() <= std::numeric_limits<uint16_t>::max());
+
+    // Fill in the failure transitions breadth first, so that every state's fallback has been finished before the state
+    // itself. Missing transitions end up pointing wherever the fallback would go, which turns the trie into a DFA.
+    std::vector<int> fail(m_states.size(), 0);
+    std::queue<int> queue;
+    for (int c = 0; c < m_classCount; ++c)
+    {
+        if (next[c] < 0)
+            next[c] = 0;
+        else
+            queue.push(next[c]);
+    }
+
+    while (!queue.empty())
+    {
+        const auto state = queue.front();
+        queue.pop();
+
+        // Any pattern that ends at the fallback also ends here
+        m_states[state].anywhere |= m_states[fail[state]].anywhere;
+        m_states[state].atEnd |= m_states[fail[state]].atEnd;
+
+        for (int c = 0; c < m_classCount; ++c)
+        {
+            auto &to = next[state * m_classCount + c];
+            if (to < 0)
+                to = next[fail[state] * m_classCount + c];
+            else
+            {
+                fail[to] = next[fail[state] * m_classCount + c];
+                queue.push(to);
+            }
+        }
+    }
+
+    m_next.assign(next.begin(), next.end());
+}
+
+uint32_t PathMatcher::match(QLatin1StringView path) const
+{
+    uint32_t found = 0;
+    size_t state = 0;
+    for (const char ch : path)
+    {
+        const auto byte = static_cast<uint8_t>(ch);
+        const auto c = byte < m_classes.size() ? m_classes[byte] : 0;
+        state = m_next[state * m_classCount + c];
+        found |= m_states[state].anywhere;
+    }
+    return found | m_states[state].atEnd;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <QLatin1StringView>
+#include <QList>
+
+// Looks for many literal patterns in a path at once using an Aho-Corasick automaton, so matching costs one table lookup
+// per character no matter how many patterns there are. Patterns are ASCII and case sensitive. Each one belongs to a
+// group, and a match reports which groups were found.
+class PathMatcher
+{
+public:
+    enum class Anchor
+    {
+        Anywhere,
+        End, // The pattern has to end the path
+    };
+
+    struct Pattern
+    {
+        QLatin1StringView text;
+        Anchor anchor;
+        uint32_t group;
+    };
+
+    explicit PathMatcher(const QList<Pattern> &patterns);
+
+    // Returns every group with a pattern in path. Paths are UTF-8; since the patterns are ASCII, they never match part of
+    // a multibyte character.
+    uint32_t match(QLatin1StringView path) const;
+
+private:
+    struct State
+    {
+        uint32_t anywhere = 0; // Groups with a pattern that ends here
+        uint32_t atEnd = 0;    // Same, but only if this is also the end of the path
+    };
+
+    // Maps ASCII to the columns of m_next. Characters that appear in no pattern share column 0.
+    std::array<uint8_t, 128> m_classes{};
+    int m_classCount = 1;
+
+    std::vector<State> m_states;
+    // m_next[state * m_classCount + class] is the state to go to next
+    std::vector<uint16_t> m_next;
+};
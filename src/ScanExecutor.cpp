@@ -0,0 +1,320 @@
+#include "ScanExecutor.h"
+
+#include <optional>
+
+#include <QFile>
+#include <QLoggingCategory>
+#include <QScopeGuard>
+#include <QThread>
+
+#if defined(Q_OS_LINUX)
+    #include <sys/stat.h>
+    #include <sys/sysmacros.h>
+#endif
+
+Q_LOGGING_CATEGORY(ScanExecutorLog, "scan")
+
+namespace
+{
+    // Which worker the current thread is, or -1 if it isn't one
+    thread_local int t_workerIndex = -1;
+
+    // How many tasks may use a drive at once. SSDs get one per thread.
+    constexpr int ROTATIONAL_LIMIT = 2;
+    constexpr int UNKNOWN_LIMIT = 4;
+
+    // How many locations may be looked up at once. Each one that hangs takes one of these with it.
+    constexpr int RESOLVER_COUNT = 2;
+
+#if defined(Q_OS_LINUX)
+    std::optional<bool> isRotational(dev_t device)
+    {
+        // Partitions don't have a queue of their own, but the disk they're on does
+        const auto sysfs = "/sys/dev/block/%1:%2"_L1.arg(major(device)).arg(minor(device));
+        for (const auto &path : {sysfs + "/queue/rotational"_L1, sysfs + "/../queue/rotational"_L1})
+            if (QFile file{path}; file.open(QIODevice::ReadOnly))
+                return file.readAll().trimmed() == "1"_ba;
+        return std::nullopt;
+    }
+
+    // btrfs and friends make up a device number instead of reporting the real one, so look it up in the mount table
+    std::optional<dev_t> backingDevice(dev_t device)
+    {
+        QFile mountInfo{"/proc/self/mountinfo"_L1};
+        if (!mountInfo.open(QIODevice::ReadOnly))
+            return std::nullopt;
+
+        const auto id = "%1:%2"_L1.arg(major(device)).arg(minor(device)).toLatin1();
+        for (const auto &line : mountInfo.readAll().split('\n'))
+        {
+            // mount ID, parent ID, major:minor, root, mount point, options, optional fields..., "-", type, source, ...
+            const auto fields = line.split(' ');
+            if (fields.size() < 3 || fields[2] != id)
+                continue;
+
+            const auto separator = fields.indexOf("-"_ba);
+            if (separator < 0 || separator + 2 >= fields.size())
+                return std::nullopt;
+
+            struct stat source;
+            if (const auto &path = fields[separator + 2];
+                path.startsWith("/dev/") && stat(path.constData(), &source) == 0 && S_ISBLK(source.st_mode))
+                return source.st_rdev;
+            return std::nullopt;
+        }
+        return std::nullopt;
+    }
+#endif
+} // namespace
+
+ScanExecutor::ScanExecutor()
+{
+    const auto count = std::max(QThread::idealThreadCount(), 1);
+    for (int i = 0; i < count; ++i)
+        m_workers.push_back(std::make_unique<Worker>());
+
+    // Only start the threads once every queue exists, since any of them may be stolen from
+    for (int i = 0; i < count; ++i)
+    {
+        auto &worker = *m_workers[i];
+        worker.thread = QThread::create([this, i] { run(i); });
+        worker.thread->setObjectName("ScanExecutor %1"_L1.arg(i));
+        worker.thread->start();
+    }
+
+#if defined(Q_OS_LINUX)
+    for (int i = 0; i < RESOLVER_COUNT; ++i)
+    {
+        auto resolver = QThread::create([this] { resolveLocations(); });
+        resolver->setObjectName("ScanExecutor resolver %1"_L1.arg(i));
+        resolver->start();
+        m_resolvers.push_back(resolver);
+    }
+#endif
+
+    qCDebug(ScanExecutorLog) << "Started" << count << "scan threads";
+}
+
+ScanExecutor *ScanExecutor::instance()
+{
+    static auto e = new ScanExecutor;
+    return e;
+}
+
+void ScanExecutor::submit(Task task)
+{
+    // Work spawned by a task is most likely to want what that task just pulled into the cache, so keep it local
+    if (t_workerIndex >= 0)
+    {
+        auto &worker = *m_workers[t_workerIndex];
+        QMutexLocker lock{&worker.mutex};
+        worker.tasks.push_front(std::move(task));
+    }
+    else
+    {
+        auto &worker = *m_workers[m_nextWorker++ % m_workers.size()];
+        QMutexLocker lock{&worker.mutex};
+        worker.tasks.push_back(std::move(task));
+    }
+
+    QMutexLocker lock{&m_idleMutex};
+    ++m_queued;
+    m_idle.wakeOne();
+}
+
+void ScanExecutor::submit(Task task, const QString &path)
+{
+#if defined(Q_OS_LINUX)
+    if (!path.isEmpty())
+    {
+        QMutexLocker lock{&m_locationsMutex};
+        if (const auto it = m_locations.constFind(path); it != m_locations.cend())
+        {
+            const auto device = *it;
+            lock.unlock();
+            if (device)
+                submitToDevice(*device, std::move(task));
+            else
+                submit(std::move(task));
+            return;
+        }
+
+        // Only the first task for a location has it looked up; the rest wait along with it
+        auto &waiting = m_resolving[path];
+        if (waiting.empty())
+        {
+            m_locationQueue.push_back(path);
+            m_locationQueued.wakeOne();
+        }
+        waiting.push_back(std::move(task));
+        return;
+    }
+#endif
+    submit(std::move(task));
+}
+
+void ScanExecutor::resolveLocations()
+{
+#if defined(Q_OS_LINUX)
+    while (true)
+    {
+        QString path;
+        {
+            QMutexLocker lock{&m_locationsMutex};
+            while (m_locationQueue.empty())
+                m_locationQueued.wait(&m_locationsMutex);
+            path = std::move(m_locationQueue.front());
+            m_locationQueue.pop_front();
+        }
+
+        std::optional<quint64> device;
+        if (struct stat st; stat(QFile::encodeName(path).constData(), &st) == 0)
+            device = st.st_dev;
+        else
+            qCDebug(ScanExecutorLog) << "Could not tell which device" << path << "is on";
+
+        std::vector<Task> tasks;
+        {
+            QMutexLocker lock{&m_locationsMutex};
+            m_locations.insert(path, device);
+            tasks = m_resolving.take(path);
+        }
+
+        for (auto &task : tasks)
+        {
+            if (device)
+                submitToDevice(*device, std::move(task));
+            else
+                submit(std::move(task));
+        }
+    }
+#endif
+}
+
+void ScanExecutor::run(int index)
+{
+    t_workerIndex = index;
+
+    while (true)
+    {
+        if (Task task; takeLocal(index, task) || steal(index, task))
+        {
+            {
+                QMutexLocker lock{&m_idleMutex};
+                --m_queued;
+            }
+
+            try
+            {
+                task();
+            }
+            catch (const std::exception &e)
+            {
+                qCWarning(ScanExecutorLog) << "Scan task failed:" << e.what();
+            }
+            continue;
+        }
+
+        QMutexLocker lock{&m_idleMutex};
+        while (m_queued <= 0)
+            m_idle.wait(&m_idleMutex);
+    }
+}
+
+bool ScanExecutor::takeLocal(int index, Task &task)
+{
+    auto &worker = *m_workers[index];
+    QMutexLocker lock{&worker.mutex};
+    if (worker.tasks.empty())
+        return false;
+
+    task = std::move(worker.tasks.front());
+    worker.tasks.pop_front();
+    return true;
+}
+
+bool ScanExecutor::steal(int thief, Task &task)
+{
+    // Start with the next worker along so that thieves don't all pile onto the same victim
+    const auto count = static_cast<int>(m_workers.size());
+    for (int i = 1; i < count; ++i)
+    {
+        auto &victim = *m_workers[(thief + i) % count];
+        QMutexLocker lock{&victim.mutex};
+        if (victim.tasks.empty())
+            continue;
+
+        task = std::move(victim.tasks.back());
+        victim.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+void ScanExecutor::submitToDevice(quint64 device, Task task)
+{
+    {
+        QMutexLocker lock{&m_devicesMutex};
+        auto it = m_devices.find(device);
+        if (it == m_devices.end())
+        {
+            it = m_devices.try_emplace(device).first;
+            it->second.limit = deviceLimit(device);
+            qCDebug(ScanExecutorLog) << "Running up to" << it->second.limit << "tasks at once on device" << Qt::hex
+                                     << device;
+        }
+
+        auto &d = it->second;
+        if (d.running >= d.limit)
+        {
+            d.waiting.push_back(std::move(task));
+            return;
+        }
+        ++d.running;
+    }
+
+    submit(deviceTask(device, std::move(task)));
+}
+
+ScanExecutor::Task ScanExecutor::deviceTask(quint64 device, Task task)
+{
+    return [this, device, task = std::move(task)] {
+        const auto done = qScopeGuard([this, device] { deviceTaskDone(device); });
+        task();
+    };
+}
+
+void ScanExecutor::deviceTaskDone(quint64 device)
+{
+    Task next;
+    {
+        QMutexLocker lock{&m_devicesMutex};
+        auto &d = m_devices[device];
+        if (d.waiting.empty())
+        {
+            --d.running;
+            return;
+        }
+
+        next = std::move(d.waiting.front());
+        d.waiting.pop_front();
+    }
+
+    // The slot passes straight on to the next task, so the device never drops below its limit while work is waiting
+    submit(deviceTask(device, std::move(next)));
+}
+
+int ScanExecutor::deviceLimit(quint64 device) const
+{
+#if defined(Q_OS_LINUX)
+    auto rotational = isRotational(device);
+    if (!rotational)
+        if (const auto backing = backingDevice(device))
+            rotational = isRotational(*backing);
+    if (rotational)
+        return *rotational ? ROTATIONAL_LIMIT : threadCount();
+#endif
+
+    // Network mounts and anything else we can't place
+    return UNKNOWN_LIMIT;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+class QThread;
+
+// A pool of threads, one per core, shared by every store for the slow parts of a scan. Each worker has its own queue:
+// work submitted from a worker goes to the front of that worker's queue, and workers that run out of work steal from the
+// back of everyone else's.
+class ScanExecutor
+{
+public:
+    using Task = std::function<void()>;
+
+    static ScanExecutor *instance();
+
+    void submit(Task task);
+    // Like submit(), but the task counts against the limit of the drive that path is on. Drives that have to seek, and
+    // drives we can't tell anything about such as network mounts, get fewer tasks at once than SSDs. That keeps each
+    // drive busy without thrashing it, and a slow drive only holds up its own games.
+    //
+    // Which drive a path is on is only looked up once per path, so pass the root of the library the task works in rather
+    // than something specific to the task where possible.
+    void submit(Task task, const QString &path);
+    int threadCount() const { return static_cast<int>(m_workers.size()); }
+
+private:
+    ScanExecutor();
+
+    struct Worker
+    {
+        QMutex mutex;
+        std::deque<Task> tasks;
+        QThread *thread = nullptr;
+    };
+
+    struct Device
+    {
+        int limit = 0;
+        int running = 0;
+        std::deque<Task> waiting;
+    };
+
+    void run(int index);
+    // Works out the devices of queued locations, then hands their tasks on
+    void resolveLocations();
+    bool takeLocal(int index, Task &task);
+    bool steal(int thief, Task &task);
+
+    void submitToDevice(quint64 device, Task task);
+    Task deviceTask(quint64 device, Task task);
+    // Starts the next task waiting for the device, or frees up its slot if there isn't one
+    void deviceTaskDone(quint64 device);
+    int deviceLimit(quint64 device) const;
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic_uint m_nextWorker = 0;
+
+    // Idle workers wait here. m_queued is only an estimate of how many tasks are in the queues, but it never stays
+    // wrong for longer than it takes to push or pop a task.
+    QMutex m_idleMutex;
+    QWaitCondition m_idle;
+    qsizetype m_queued = 0;
+
+    QMutex m_devicesMutex;
+    std::unordered_map<quint64, Device> m_devices;
+
+    // Even stat() can hang on a network mount, so locations are looked up on a few threads of their own instead of on the
+    // workers. Tasks wait in m_resolving until their location has been looked up.
+    std::vector<QThread *> m_resolvers;
+    QMutex m_locationsMutex;
+    QWaitCondition m_locationQueued;
+    std::deque<QString> m_locationQueue;
+    QHash<QString, std::vector<Task>> m_resolving;
+    QHash<QString, std::optional<quint64>> m_locations; // Empty if the location couldn't be looked up
+};
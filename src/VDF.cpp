@@ -27,258 +27,512 @@
 
 #include "VDF.h"
 
-#include <QDir>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QLoggingCategory>
-#include <QStandardPaths>
-#include <QTimer>
-
-#include "stores/Steam.h"
+#include <QMutex>
+#include <QTextStream>
+#include <QVarLengthArray>
+#include <QtEndian>
 
 Q_LOGGING_CATEGORY(VDFLog, "vdf")
 
 namespace
 {
     constexpr uint32_t LAST_STEAM_APP = 0;
-}
+    // Steam doesn't rewrite appinfo.vdf often, so a read that races with it twice in a row is already unlikely
+    constexpr int MAX_READ_ATTEMPTS = 3;
+
+    using Section = AppInfoVDF::AppInfo::Section;
+
+    // Moves cur past a key name. Names are string table indices since 0x29 and inline strings before that.
+    bool skipName(const uint8_t *&cur, const uint8_t *end, bool stringTable)
+    {
+        if (cur >= end)
+            return false;
+
+        if (stringTable)
+            cur += sizeof(uint32_t);
+        else if (const auto nul = static_cast<const uint8_t *>(memchr(cur, '\0', end - cur)))
+            cur = nul + 1;
+        else
+            return false;
+
+        return cur <= end;
+    }
+
+    bool skipValue(Section::_TokenOp op, const uint8_t *&cur, const uint8_t *end)
+    {
+        if (cur >= end)
+            return false;
+
+        switch (op)
+        {
+        case Section::String:
+            if (const auto nul = static_cast<const uint8_t *>(memchr(cur, '\0', end - cur)))
+            {
+                cur = nul + 1;
+                return true;
+            }
+            return false;
+        case Section::Int32:
+            cur += sizeof(int32_t);
+            return cur <= end;
+        case Section::Int64:
+            cur += sizeof(int64_t);
+            return cur <= end;
+        default:
+            return false;
+        }
+    }
+
+    // Moves cur past the end of the section it is currently in without looking at anything inside it
+    bool skipSection(const uint8_t *&cur, const uint8_t *end, bool stringTable)
+    {
+        for (int depth = 1; cur < end;)
+        {
+            const auto op = static_cast<Section::_TokenOp>(*cur++);
+            if (op == Section::SectionEnd)
+            {
+                if (--depth == 0)
+                    return true;
+                continue;
+            }
 
-uint32_t AppInfoVDF::vdf_version = 0x27; // Default to Pre-December 2022
+            if (!skipName(cur, end, stringTable))
+                return false;
+            if (op == Section::SectionBegin)
+                ++depth;
+            else if (!skipValue(op, cur, end))
+                return false;
+        }
+
+        return false;
+    }
+} // namespace
 
-AppInfoVDF::AppInfoVDF()
-    : m_appInfoPath{Steam::instance()->storeRoot() + "/appcache/appinfo.vdf"_L1}
+AppInfoVDF::AppInfoVDF(const QString &path)
+    : m_appInfoPath{path},
+      m_file{m_appInfoPath}
 {
     if (!QFileInfo::exists(m_appInfoPath))
         return;
 
-    QFile dataFile{m_appInfoPath};
-    if (dataFile.open(QIODevice::ReadOnly))
+    // Loading is on the startup path of every scan, so keep an eye on how long each stage takes
+    QElapsedTimer timer;
+    timer.start();
+
+    if (m_file.open(QIODevice::ReadOnly))
     {
-        m_data = dataFile.readAll();
-        base = reinterpret_cast<Header *>(m_data.data());
+        // Steam can rewrite appinfo.vdf in place, and a mapping of a file that shrinks kills us with SIGBUS the next time
+        // anything touches the pages that are gone, which no check of ours could catch in time. So it's copied instead,
+        // and copied again if it changed while being read, so that what gets parsed is at least one version of the file.
+        for (int attempt = 0; attempt < MAX_READ_ATTEMPTS; ++attempt)
+        {
+            const auto size = m_file.size();
+            m_lastModified = m_file.fileTime(QFileDevice::FileModificationTime);
+            if (!m_file.seek(0))
+                break;
+            m_data = m_file.readAll();
+            if (m_data.size() == size && m_file.size() == size &&
+                m_file.fileTime(QFileDevice::FileModificationTime) == m_lastModified)
+                break;
+            qCDebug(VDFLog) << m_appInfoPath << "changed while it was being read";
+        }
+        m_begin = reinterpret_cast<uchar *>(m_data.data());
+        m_size = m_data.size();
+
+        if (m_size < static_cast<qint64>(sizeof(Header)))
+        {
+            qCWarning(VDFLog) << m_appInfoPath << "is too small to be valid";
+            return;
+        }
+
+        base = reinterpret_cast<Header *>(m_begin);
 
         vdf_version = (reinterpret_cast<uint8_t *>(&base->version))[0];
         root = &base->head;
 
+        switch (vdf_version)
+        {
+        case 0x29: // v41
+            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (June 2024)";
+            break;
+        case 0x28: // v40
+            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (December 2022)";
+            break;
+        case 0x27: // v39
+            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (pre-December 2022)";
+            break;
+        default:
+            qWarning() << "appinfo.vdf version: " << vdf_version << " (unknown/unsupported)";
+        }
+
         // A string table was added in June of 2024 (0x29)
         if (vdf_version >= 0x29)
         {
-            uintptr_t strtable_pos = (uintptr_t)*(uint64_t *)root;
+            const auto strtable_pos = qFromUnaligned<uint64_t>(root);
             root = (AppInfo *)((uint64_t *)root + 1);
-            table = (StringTable *)(&m_data[strtable_pos]);
-
-            // Valve is using 64-bit offsets, if this file is larger than
-            // 4 GiB SKIF32 is fundamentally inoperable!
-            if (*(uint64_t *)root > std::numeric_limits<uintptr_t>::max())
-                qCritical() << "VDF File is Too Large!";
 
-            m_strs.reserve(table->num_strings);
-            m_strs.push_back((char *)table->strings);
+            // A file that Steam was in the middle of writing can point anywhere
+            if (strtable_pos < offsetof(Header, head) + sizeof(uint64_t) + sizeof(AppId_t) ||
+                strtable_pos > static_cast<uint64_t>(m_size) - sizeof(StringTable::num_strings))
+            {
+                qCritical() << "String table of" << m_appInfoPath << "is out of bounds:" << strtable_pos;
+                return;
+            }
+            table = (StringTable *)(m_begin + strtable_pos);
 
-            char *str = (char *)table->strings;
-            char *end_tbl = (char *)m_data.data() + m_data.size();
+            const auto strings = reinterpret_cast<const char *>(table->strings);
+            const auto tableSize = static_cast<size_t>(reinterpret_cast<const char *>(m_begin + m_size) - strings);
 
-            for (uint32_t i = 1; i < table->num_strings; ++i)
+            // Every string takes at least its terminator, so a count larger than the table can only be garbage
+            auto stringCount = table->num_strings;
+            if (stringCount > tableSize)
             {
-                while (*str++ != '\0' && str < end_tbl)
-                    ;
+                qCritical() << "String table of" << m_appInfoPath << "claims" << stringCount << "strings in" << tableSize
+                            << "bytes";
+                stringCount = static_cast<uint32_t>(tableSize);
+            }
+            m_strOffsets = indexStrings({strings, static_cast<qsizetype>(tableSize)}, stringCount);
+            qCDebug(VDFLog) << "Indexed" << m_strOffsets.size() << "strings in" << timer.restart() << "ms";
+        }
 
-                if (str > end_tbl)
-                {
-                    // On overflow, restart table iteration from the beginning
-                    qCritical() << "Malformed string table detected!";
-                    str = (char *)table->strings;
-                }
+        // Index every app in one pass so that game() doesn't have to walk the chain for every installed game. Records end
+        // where the string table starts, if there is one.
+        const auto end = table ? reinterpret_cast<const uchar *>(table) : m_begin + m_size;
+        const auto headerSize = vdf_version > 0x27 ? sizeof(AppInfo) : sizeof(AppInfo27);
+        for (auto info = root; info && info->appid != LAST_STEAM_APP; info = info->getNextApp(vdf_version))
+        {
+            if (static_cast<size_t>(end - reinterpret_cast<const uchar *>(info)) < headerSize)
+            {
+                qCWarning(VDFLog) << "App" << info->appid << "runs past the end of" << m_appInfoPath;
+                break;
+            }
 
-                m_strs.push_back(str);
+            // The next app's ID has to fit after this one too
+            size_t kvSize;
+            const auto section = static_cast<const uchar *>(info->getRootSection(vdf_version, &kvSize));
+            if (info->size < headerSize - 8 || kvSize + sizeof(AppId_t) > static_cast<size_t>(end - section))
+            {
+                qCWarning(VDFLog) << "App" << info->appid << "runs past the end of" << m_appInfoPath;
+                break;
             }
+
+            m_apps.insert(info->appid, info);
         }
+        qCDebug(VDFLog) << "Indexed" << m_apps.size() << "apps from" << m_appInfoPath << "in" << timer.elapsed() << "ms";
     }
-
-    QTimer::singleShot(0, [this] { dumpAppInfo(); });
 }
 
-void AppInfoVDF::dumpAppInfo()
+void AppInfoVDF::dumpAppInfo(const QString &path)
 {
-    qCInfo(VDFLog) << "Dumping app info to"
-                   << QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/appinfo/"_L1;
+    qCInfo(VDFLog) << "Dumping app info to" << path;
 
-    QDir d{QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/appinfo/"_L1};
-    if (d.exists())
-        d.removeRecursively();
-
-    AppInfoVDF::AppInfo *info = root;
-    while (info && info->appid != LAST_STEAM_APP)
+    QFile f{path};
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
     {
-        QDir{QStandardPaths::writableLocation(QStandardPaths::CacheLocation)}.mkdir("appinfo"_L1);
+        qCWarning(VDFLog) << "Could not open" << path << "for writing:" << f.errorString();
+        return;
+    }
 
-        QFile f{QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/appinfo/"_L1 +
-                QString::number(info->appid)};
-        if (f.open(QIODevice::WriteOnly | QIODevice::Truncate))
-        {
-            QTextStream s{&f};
+    f.write("# Dump of " + m_appInfoPath.toUtf8() + "\n"_ba);
+    f.write("# The last line holds the offset of an index mapping every appid to the offset of its entry\n"_ba);
+
+    auto appIds = m_apps.keys();
+    std::sort(appIds.begin(), appIds.end());
+
+    QList<QPair<AppId_t, qint64>> index;
+    index.reserve(appIds.size());
 
-            static AppInfo::Section section;
-            AppInfo::SectionDesc app_desc{};
+    const auto ctx = context();
+
+    for (const auto appId : std::as_const(appIds))
+    {
+        auto *info = m_apps.value(appId);
 
-            section.finished_sections.clear();
-            app_desc.blob = info->getRootSection(&app_desc.size);
-            section.parse(app_desc);
+        QString entry;
+        QTextStream s{&entry};
+        s << "[app "_L1 << appId << " change "_L1 << info->change_num << "]\n"_L1;
 
-            for (auto &finished_section : section.finished_sections)
+        AppInfo::Section section;
+        AppInfo::SectionDesc app_desc{};
+        app_desc.blob = info->getRootSection(vdf_version, &app_desc.size);
+        if (!section.parse(app_desc, ctx))
+            s << "# malformed, the following is incomplete\n"_L1;
+
+        for (auto &finished_section : section.finished_sections)
+        {
+            s << finished_section.name << '\n';
+            for (const auto &[key, value] : std::as_const(finished_section.keys))
             {
-                s << finished_section.name << '\n';
-                for (const auto &[key, value] : std::as_const(finished_section.keys))
+                switch (value.first)
                 {
-                    switch (value.first)
-                    {
-                    case AppInfo::Section::Int32:
-                        s << "\ti32: "_L1 << key << " = "_L1 << *static_cast<int32_t *>(value.second);
-                        break;
-                    case AppInfo::Section::Int64:
-                        s << "\ti64: "_L1 << key << " = "_L1 << *static_cast<int64_t *>(value.second);
-                        break;
-                    case AppInfo::Section::String:
-                        s << "\tstr: "_L1 << key << " = "_L1 << static_cast<const char *>(value.second);
-                        break;
-                    default:
-                        break;
-                    }
-                    s << '\n';
+                case AppInfo::Section::Int32:
+                    s << "\ti32: "_L1 << key << " = "_L1 << *static_cast<int32_t *>(value.second);
+                    break;
+                case AppInfo::Section::Int64:
+                    s << "\ti64: "_L1 << key << " = "_L1 << *static_cast<int64_t *>(value.second);
+                    break;
+                case AppInfo::Section::String:
+                    s << "\tstr: "_L1 << key << " = "_L1 << static_cast<const char *>(value.second);
+                    break;
+                default:
+                    break;
                 }
+                s << '\n';
             }
         }
+        s.flush();
 
-        info = info->getNextApp();
+        index.push_back({appId, f.pos()});
+        f.write(entry.toUtf8());
     }
+
+    const auto indexOffset = f.pos();
+    QByteArray indexData{"[index]\n"};
+    for (const auto &[appId, offset] : std::as_const(index))
+        indexData += QByteArray::number(appId) + ' ' + QByteArray::number(offset) + '\n';
+    indexData += "index-offset "_ba + QByteArray::number(indexOffset) + '\n';
+    f.write(indexData);
+
+    qCInfo(VDFLog) << "Dumped" << index.size() << "apps to" << path;
 }
 
-void AppInfoVDF::AppInfo::Section::parse(SectionDesc &desc)
+bool AppInfoVDF::AppInfo::Section::parse(const SectionDesc &desc, const ParseContext &ctx)
 {
-    static std::map<_TokenOp, size_t> operand_sizes = {{Int32, sizeof(int32_t)}, {Int64, sizeof(int64_t)}};
     std::vector<SectionData> raw_sections;
-    static bool exception = false;
+    bool malformed = false;
 
-    if (!exception)
+    for (uint8_t *cur = (uint8_t *)desc.blob; !malformed && cur < (uint8_t *)desc.blob + desc.size; cur++)
     {
-        for (uint8_t *cur = (uint8_t *)desc.blob; cur < (uint8_t *)desc.blob + desc.size; cur++)
+        auto op = (_TokenOp)(*cur);
+        auto name = (const char *)(cur + 1);
+        if (op != SectionEnd)
         {
-            auto op = (_TokenOp)(*cur);
-            auto name = (char *)(cur + 1);
-            if (op != SectionEnd)
+            // String Table Lookup (June 2024+)
+            //
+            if (ctx.version >= 0x29)
             {
-                // String Table Lookup (June 2024+)
-                //
-                if (AppInfoVDF::instance()->vdf_version >= 0x29)
-                {
-                    name = (char *)AppInfoVDF::instance()->table->strings;
-
-                    const auto str_idx = *(uint32_t *)(cur + 1);
+                const auto str_idx = qFromUnaligned<uint32_t>(cur + 1);
 
 #ifdef DEBUG
-                    qCDebug(VDFLog) << "String Table Index:  " << str_idx << ", op=" << op;
+                qCDebug(VDFLog) << "String Table Index:  " << str_idx << ", op=" << op;
 #endif
 
-                    if (str_idx < AppInfoVDF::instance()->table->num_strings)
-                    {
-                        name = AppInfoVDF::instance()->m_strs[str_idx];
+                if (const auto str = ctx.string(str_idx))
+                {
+                    name = str;
 #ifdef DEBUG
-                        qCDebug(VDFLog) << "String=" << name;
+                    qCDebug(VDFLog) << "String=" << name;
 #endif
-                    }
-                    else
-                        qCritical() << "String Table Index (" << str_idx << ") Out-of-Range!";
-
-                    cur += 4;
                 }
-
-                // Legacy: null-terminated name is serialized inline after token type
-                //
                 else
                 {
-                    // Skip past name declarations, except for </Section> because it has no name.
-                    cur++;
-                    while (*cur != '\0')
-                        ++cur;
+                    qCritical() << "String Table Index (" << str_idx << ") Out-of-Range!";
+                    name = (const char *)ctx.table->strings;
                 }
+
+                cur += 4;
             }
 
-            if (op == SectionBegin)
+            // Legacy: null-terminated name is serialized inline after token type
+            //
+            else
             {
-                if (!raw_sections.empty())
-                    raw_sections.push_back({raw_sections.back().name + '.' + name, {(void *)cur, 0}});
-                else
-                    raw_sections.push_back({name, {(void *)cur, 0}});
+                // Skip past name declarations, except for </Section> because it has no name.
+                cur++;
+                while (*cur != '\0')
+                    ++cur;
             }
-            else if (op == SectionEnd)
+        }
+
+        if (op == SectionBegin)
+        {
+            if (!raw_sections.empty())
+                raw_sections.push_back({raw_sections.back().name + '.' + name, {(void *)cur, 0}});
+            else
+                raw_sections.push_back({name, {(void *)cur, 0}});
+        }
+        else if (op == SectionEnd)
+        {
+            if (!raw_sections.empty())
             {
-                if (!raw_sections.empty())
-                {
-                    raw_sections.back().desc.size = (uintptr_t)cur - (uintptr_t)raw_sections.back().desc.blob;
-                    finished_sections.push_back(raw_sections.back());
-                    raw_sections.pop_back();
-                }
+                raw_sections.back().desc.size = (uintptr_t)cur - (uintptr_t)raw_sections.back().desc.blob;
+                finished_sections.push_back(raw_sections.back());
+                raw_sections.pop_back();
             }
-            else
+        }
+        else
+        {
+            ++cur;
+
+            switch (op)
             {
-                ++cur;
+            case String:
+                if (!raw_sections.empty())
+                    raw_sections.back().keys.push_back({name, {String, (void *)cur}});
+                else
+                    malformed = true;
 
-                switch (op)
-                {
-                case String:
-                    if (!raw_sections.empty())
-                        raw_sections.back().keys.push_back({name, {String, (void *)cur}});
-                    else
-                        exception = true;
-
-                    while (*cur != '\0')
-                        ++cur;
-                    break;
+                while (*cur != '\0')
+                    ++cur;
+                break;
 
-                case Int32:
-                case Int64:
-                    if (!raw_sections.empty())
-                        raw_sections.back().keys.push_back({name, {op, (void *)cur}});
-                    else
-                        exception = true;
+            case Int32:
+            case Int64:
+                if (!raw_sections.empty())
+                    raw_sections.back().keys.push_back({name, {op, (void *)cur}});
+                else
+                    malformed = true;
 
-                    cur += (operand_sizes[op] - 1);
-                    break;
+                cur += (op == Int32 ? sizeof(int32_t) : sizeof(int64_t)) - 1;
+                break;
 
-                default:
-                    qWarning() << "Unknown VDF Token Operator: " << op;
-                    exception = true;
-                    break;
-                }
+            default:
+                qWarning() << "Unknown VDF Token Operator: " << op;
+                malformed = true;
+                break;
             }
         }
     }
+
+    return !malformed;
+}
+
+AppInfoVDF::AppInfo::Query::Query(const QList<QByteArrayView> &paths)
+{
+    Q_ASSERT(paths.size() <= 64);
+
+    m_paths.reserve(paths.size());
+    for (const auto path : paths)
+        m_paths.push_back(path.toByteArray().split('.'));
 }
 
-void *AppInfoVDF::AppInfo::getRootSection(size_t *pSize)
+void AppInfoVDF::AppInfo::Query::run(const SectionDesc &desc,
+                                     const ParseContext &ctx,
+                                     const std::function<void(const Match &)> &callback) const
 {
-    size_t vdf_header_size = (vdf_version > 0x27 ? sizeof(AppInfo) : sizeof(AppInfo27));
+    const bool stringTable = ctx.version >= 0x29;
+
+    auto cur = static_cast<const uint8_t *>(desc.blob);
+    const auto end = cur + desc.size;
+
+    // live holds one bitmask of still-reachable paths per open section (plus one for the top level), so deciding whether
+    // to descend into a section only has to look at the paths that matched all of its parents
+    QVarLengthArray<const char *, 16> sections;
+    QVarLengthArray<uint64_t, 16> live;
+    live.append(m_paths.size() >= 64 ? ~uint64_t{0} : (uint64_t{1} << m_paths.size()) - 1);
+
+    const auto matching = [&](uint64_t candidates, const char *name, bool isKey) {
+        const auto depth = sections.size();
+        uint64_t result = 0;
+        for (; candidates; candidates &= candidates - 1)
+        {
+            const auto p = std::countr_zero(candidates);
+            const auto &segments = m_paths[p];
+            if ((isKey ? segments.size() == depth + 1 : segments.size() > depth + 1) &&
+                (segments[depth] == "*" || segments[depth] == name))
+                result |= uint64_t{1} << p;
+        }
+        return result;
+    };
 
-    static bool runOnce = true;
-    if (runOnce)
+    while (cur < end)
     {
-        runOnce = false;
+        const auto op = static_cast<Section::_TokenOp>(*cur++);
+        if (op == Section::SectionEnd)
+        {
+            if (sections.isEmpty())
+                return;
+            sections.removeLast();
+            live.removeLast();
+            continue;
+        }
 
-        switch (vdf_version)
+        const char *name = nullptr;
+        if (!stringTable)
+            name = reinterpret_cast<const char *>(cur);
+        else if (cur + sizeof(uint32_t) <= end)
+            name = ctx.string(qFromUnaligned<uint32_t>(cur));
+
+        if (!name || !skipName(cur, end, stringTable))
         {
-        case 0x29: // v41
-            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (June 2024)";
-            break;
-        case 0x28: // v40
-            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (December 2022)";
-            break;
-        case 0x27: // v39
-            qCDebug(VDFLog) << "appinfo.vdf version: " << vdf_version << " (pre-December 2022)";
-            break;
-        default:
-            qWarning() << "appinfo.vdf version: " << vdf_version << " (unknown/unsupported)";
+            qCWarning(VDFLog) << "Malformed key name in app info";
+            return;
+        }
+
+        if (op == Section::SectionBegin)
+        {
+            if (const auto next = matching(live.back(), name, false); next)
+            {
+                sections.append(name);
+                live.append(next);
+            }
+            else if (!skipSection(cur, end, stringTable))
+                return;
+        }
+        else
+        {
+            const auto value = cur;
+            if (!skipValue(op, cur, end))
+            {
+                qCWarning(VDFLog) << "Unknown VDF Token Operator or truncated value: " << op;
+                return;
+            }
+
+            for (auto matches = matching(live.back(), name, true); matches; matches &= matches - 1)
+                callback({std::countr_zero(matches),
+                          {sections.constData(), sections.size()},
+                          op,
+                          const_cast<uint8_t *>(value)});
         }
     }
+}
+
+const char *AppInfoVDF::AppInfo::Query::Match::toString() const
+{
+    return type == Section::String ? static_cast<const char *>(value) : "";
+}
+
+int64_t AppInfoVDF::AppInfo::Query::Match::toInt() const
+{
+    switch (type)
+    {
+    case Section::Int32:
+        return qFromUnaligned<int32_t>(value);
+    case Section::Int64:
+        return qFromUnaligned<int64_t>(value);
+    case Section::String:
+        return QByteArrayView{static_cast<const char *>(value)}.toLongLong();
+    default:
+        return 0;
+    }
+}
+
+double AppInfoVDF::AppInfo::Query::Match::toDouble() const
+{
+    switch (type)
+    {
+    case Section::Int32:
+        return qFromUnaligned<int32_t>(value);
+    case Section::Int64:
+        return qFromUnaligned<int64_t>(value);
+    case Section::String:
+        return QByteArrayView{static_cast<const char *>(value)}.toDouble();
+    default:
+        return 0;
+    }
+}
+
+void *AppInfoVDF::AppInfo::getRootSection(uint32_t version, size_t *pSize)
+{
+    size_t vdf_header_size = (version > 0x27 ? sizeof(AppInfo) : sizeof(AppInfo27));
 
     size_t kv_size = (size - vdf_header_size + 8);
 
@@ -288,31 +542,71 @@ void *AppInfoVDF::AppInfo::getRootSection(size_t *pSize)
     return (uint8_t *)&appid + vdf_header_size;
 }
 
-AppInfoVDF::AppInfo *AppInfoVDF::AppInfo::getNextApp(void)
+AppInfoVDF::AppInfo *AppInfoVDF::AppInfo::getNextApp(uint32_t version)
 {
     SectionDesc root_sec{};
 
-    root_sec.blob = getRootSection(&root_sec.size);
+    root_sec.blob = getRootSection(version, &root_sec.size);
 
     auto *pNext = (AppInfo *)((uint8_t *)root_sec.blob + root_sec.size);
 
     return (pNext->appid == LAST_STEAM_APP) ? nullptr : pNext;
 }
 
-AppInfoVDF *AppInfoVDF::instance()
+QList<uint32_t> AppInfoVDF::indexStrings(QByteArrayView strings, uint32_t count)
+{
+    QList<uint32_t> offsets;
+    offsets.reserve(count);
+
+    // memchr() is vectorized in any libc worth using, which matters with tens of thousands of names to find
+    const auto size = static_cast<size_t>(strings.size());
+    size_t offset = 0;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (offset >= size)
+        {
+            // Point whatever is left at the first string rather than past the end of the table
+            qCritical() << "Malformed string table detected!";
+            offsets.resize(count, 0);
+            break;
+        }
+
+        offsets.push_back(static_cast<uint32_t>(offset));
+        const auto nul = static_cast<const char *>(memchr(strings.data() + offset, '\0', size - offset));
+        offset = nul ? static_cast<size_t>(nul - strings.data()) + 1 : size;
+    }
+
+    return offsets;
+}
+
+std::shared_ptr<AppInfoVDF> AppInfoVDF::load(const QString &path)
 {
-    static auto vdf = new AppInfoVDF;
+    // Scans only ever share a snapshot while it's still current; once the last of them lets go of an outdated one, it gets
+    // freed
+    static QMutex mutex;
+    static std::weak_ptr<AppInfoVDF> loaded;
+
+    QMutexLocker lock{&mutex};
+    if (auto vdf = loaded.lock(); vdf && vdf->m_appInfoPath == path && vdf->isCurrent())
+        return vdf;
+
+    std::shared_ptr<AppInfoVDF> vdf{new AppInfoVDF{path}};
+    loaded = vdf;
     return vdf;
 }
 
-AppInfoVDF::AppInfo *AppInfoVDF::game(int steamId)
+bool AppInfoVDF::isCurrent() const
 {
-    AppInfoVDF::AppInfo *info = root;
-    while (info && info->appid != LAST_STEAM_APP)
-    {
-        if (info->appid == steamId)
-            return info;
-        info = info->getNextApp();
-    }
-    return nullptr;
+    const QFileInfo info{m_appInfoPath};
+    return info.exists() == m_file.isOpen() && info.size() == m_size && info.lastModified() == m_lastModified;
+}
+
+AppInfoVDF::ParseContext AppInfoVDF::context() const
+{
+    return {vdf_version, table, {m_strOffsets.constData(), m_strOffsets.size()}};
+}
+
+AppInfoVDF::AppInfo *AppInfoVDF::game(int steamId) const
+{
+    return m_apps.value(steamId, nullptr);
 }
@@ -28,9 +28,16 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 #include <QByteArray>
+#include <QByteArrayView>
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
 #include <QList>
+#include <QSpan>
 #include <QString>
 
 class Game;
@@ -43,7 +50,13 @@ typedef uint32_t AppId_t;
 class AppInfoVDF
 {
 public:
-    static AppInfoVDF *instance();
+    // The appinfo.vdf at path as it is on disk right now. Steam rewrites the file while it runs, so it's loaded again
+    // whenever its size or modification time has changed, and each copy only lives as long as somebody holds on to it.
+    static std::shared_ptr<AppInfoVDF> load(const QString &path);
+
+    ~AppInfoVDF() = default;
+
+    struct ParseContext;
 
     struct AppInfo27
     {
@@ -91,11 +104,41 @@ public:
 
             QList<SectionData> finished_sections;
 
-            void parse(SectionDesc &desc);
+            // Returns false if the section turned out to be malformed; whatever was parsed up to that point is kept
+            bool parse(const SectionDesc &desc, const ParseContext &ctx);
+        };
+
+        // Pulls individual keys out of an app's sections without building the full section tree. Paths are dotted
+        // section names ending in a key, e.g. "appinfo.common.type"; a "*" segment matches any single section name, e.g.
+        // "appinfo.config.launch.*.executable". Sections that can't contain any of the paths are skipped outright.
+        class Query
+        {
+        public:
+            struct Match
+            {
+                qsizetype path; // Index into the list of paths the query was created with
+                QSpan<const char *const> sections; // Names of the enclosing sections, outermost first
+                Section::_TokenOp type;
+                void *value;
+
+                const char *toString() const;
+                int64_t toInt() const;
+                double toDouble() const;
+            };
+
+            // At most 64 paths are supported
+            explicit Query(const QList<QByteArrayView> &paths);
+
+            void run(const SectionDesc &desc,
+                     const ParseContext &ctx,
+                     const std::function<void(const Match &)> &callback) const;
+
+        private:
+            QList<QList<QByteArray>> m_paths;
         };
 
-        void *getRootSection(size_t *pSize = nullptr);
-        AppInfo *getNextApp(void);
+        void *getRootSection(uint32_t version, size_t *pSize = nullptr);
+        AppInfo *getNextApp(uint32_t version);
     };
 
     struct Header
@@ -113,20 +156,52 @@ public:
         uint8_t strings[1];
     };
 
-    AppInfo *game(int steamId);
+    // Everything about the file that parsing a section depends on. Parsing only ever reads from this, so any number of
+    // apps can be parsed at once from different threads.
+    struct ParseContext
+    {
+        uint32_t version = 0x27;
+        const StringTable *table = nullptr;
+        QSpan<const uint32_t> stringOffsets;
+
+        // Since 0x29, names are indices into the string table
+        const char *string(uint32_t index) const
+        {
+            return index < stringOffsets.size() ? reinterpret_cast<const char *>(table->strings) + stringOffsets[index]
+                                                : nullptr;
+        }
+    };
+
+    ParseContext context() const;
+
+    // Finds where each of the count strings packed one after the other into strings starts. Strings that would start past
+    // the end point at the first one.
+    static QList<uint32_t> indexStrings(QByteArrayView strings, uint32_t count);
+
+    AppInfo *game(int steamId) const;
+
+    // Size and modification time of appinfo.vdf as it was when it was loaded
+    qint64 fileSize() const { return m_size; }
+    QDateTime lastModified() const { return m_lastModified; }
+    // Whether appinfo.vdf still looks the way it did when it was loaded. Anything read from an outdated copy is stale.
+    bool isCurrent() const;
 
-    // For debug purposes only - dump every app's info into files in the cache directory
-    void dumpAppInfo();
+    // For debug purposes only - dump every app's info into a single file, followed by an index of where each app starts
+    void dumpAppInfo(const QString &path);
 
 private:
-    AppInfoVDF();
-    ~AppInfoVDF() {}
+    explicit AppInfoVDF(const QString &path);
 
-    static uint32_t vdf_version;
+    uint32_t vdf_version = 0x27; // Default to Pre-December 2022
 
     QString m_appInfoPath;
+    QFile m_file;
     QByteArray m_data;
-    QList<char *> m_strs; // Preparsed array of pointers
+    uchar *m_begin = nullptr; // Start of m_data
+    qint64 m_size = 0;
+    QDateTime m_lastModified;
+    QList<uint32_t> m_strOffsets; // Where each string starts, relative to the start of the string table
+    QHash<AppId_t, AppInfo *> m_apps;
 
     Header *base = nullptr;
     AppInfo *root = nullptr;
@@ -12,7 +12,15 @@ Q_LOGGING_CATEGORY(WineLog, "wine")
 
 Wine::Wine(QObject *parent)
     : QObject{parent}
-{}
+{
+    // Looking for Wine means running `which` and going through every game, far too slow for each time a game's Wine is
+    // asked for. What it finds only changes when Steam or Heroic find new Protons.
+    for (const auto store : {static_cast<Store *>(Steam::instance()), static_cast<Store *>(Heroic::instance())})
+        connect(store, &Store::scanningChanged, this, [this](bool scanning) {
+            if (!scanning)
+                m_whichWine.reset();
+        });
+}
 
 Wine *Wine::instance()
 {
@@ -89,6 +97,9 @@ void Wine::runInWine(const QString &prettyName,
 
 QString Wine::whichWine() const
 {
+    if (m_whichWine)
+        return *m_whichWine;
+
     QString result;
 
     QProcess whichWineProc;
@@ -103,6 +114,8 @@ QString Wine::whichWine() const
             if (!g->wineBinary().isEmpty())
                 result = g->wineBinary();
 
+    qCDebug(WineLog) << "Default Wine is" << result;
+    m_whichWine = result;
     return result;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+
 #include <QObject>
 #include <QQmlEngine>
 
@@ -23,6 +25,8 @@ public:
         std::function<void()> successCallback = [] {},
         std::function<void()> failureCallback = [] {});
 
+    // The system's Wine, or failing that a Proton from Steam or Heroic. Looked up once, then again whenever Steam or Heroic
+    // finish a scan.
     Q_INVOKABLE QString whichWine() const;
     Q_INVOKABLE QString defaultWinePrefix() const;
 
@@ -32,4 +36,6 @@ signals:
 private:
     explicit Wine(QObject *parent = nullptr);
     ~Wine() = default;
+
+    mutable std::optional<QString> m_whichWine;
 };
@@ -7,17 +7,21 @@
 #include <QQmlContext>
 #include <QSettings>
 #include <QStandardPaths>
+#include <QThread>
 
 #include "Aptabase.h"
 #include "CustomGames.h"
+#include "DetectionCache.h"
 #include "Dotnet.h"
 #include "GamesFilterModel.h"
 #include "Heroic.h"
 #include "Itch.h"
+#include "KnownGames.h"
 #include "Portal2VR.h"
 #include "Steam.h"
 #include "UEVR.h"
 #include "UpdateChecker.h"
+#include "VDF.h"
 #include "Wine.h"
 
 #if defined EXPERIMENTAL_UUVR_SUPPORT
@@ -82,6 +86,9 @@ int main(int argc, char *argv[])
     p.addVersionOption();
     QCommandLineOption shouldLogDebug{"debug"_L1};
     p.addOption(shouldLogDebug);
+    QCommandLineOption shouldDumpAppInfo{
+        "dump-appinfo"_L1, "Dump every app in Steam's appinfo.vdf to appinfo_dump.txt in the cache directory."_L1};
+    p.addOption(shouldDumpAppInfo);
     p.process(app);
     if (p.isSet(shouldLogDebug))
         DEBUG_TO_STDOUT = true;
@@ -91,8 +98,22 @@ int main(int argc, char *argv[])
     Aptabase::init("aptabase.lorendb.dev"_L1, "A-SH-5394792661"_L1);
     Aptabase::instance()->track("startup"_L1);
 
+    // Map the known games database before any store starts scanning
+    KnownGames::instance();
+
+    // Older versions of Kaon dumped every app in appinfo.vdf into its own file in the cache on every startup. That can be
+    // tens of thousands of files, so get rid of them without holding up startup.
+    if (QDir legacy{QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/appinfo"_L1}; legacy.exists())
+    {
+        auto cleaner = QThread::create([legacy]() mutable { legacy.removeRecursively(); });
+        QObject::connect(cleaner, &QThread::finished, cleaner, &QObject::deleteLater);
+        cleaner->start(QThread::LowPriority);
+    }
+
     QObject::connect(&app, &QApplication::aboutToQuit, &app, [] {
         qInfo() << "Shutting down";
+        // Games can finish detecting in the background long after their store's scan has saved the cache
+        DetectionCache::instance()->save();
         Aptabase::instance()->track("shutdown"_L1, {}, true);
     });
 
@@ -120,6 +141,17 @@ int main(int argc, char *argv[])
     UUVR::instance();
 #endif
 
+    if (p.isSet(shouldDumpAppInfo))
+    {
+        // Load appinfo.vdf here so that the dump thread only ever reads from it
+        const auto vdf = AppInfoVDF::load(Steam::instance()->storeRoot() + "/appcache/appinfo.vdf"_L1);
+        auto dumper = QThread::create([vdf] {
+            vdf->dumpAppInfo(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/appinfo_dump.txt"_L1);
+        });
+        QObject::connect(dumper, &QThread::finished, dumper, &QObject::deleteLater);
+        dumper->start(QThread::LowPriority);
+    }
+
     QQmlApplicationEngine engine;
     QObject::connect(
         &engine,
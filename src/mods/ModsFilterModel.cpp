@@ -71,9 +71,20 @@ void ModsFilterModel::registerMod(Mod *mod)
 
 void ModsFilterModel::setGame(Game *game)
 {
+    if (m_game)
+        disconnect(m_game, nullptr, this, nullptr);
+
     beginFilterChange();
     m_game = game;
     endFilterChange();
+
+    // Which mods fit depends on the engine, which finishDetection() may only work out once the game is shown. Fit decides
+    // the order too, so this re-sorts as well as refilters.
+    if (m_game)
+    {
+        connect(m_game, &Game::engineChanged, this, &ModsFilterModel::invalidate);
+        connect(m_game, &QObject::destroyed, this, [this] { setGame(nullptr); });
+    }
 }
 
 void ModsFilterModel::setSearch(const QString &search)
@@ -10,6 +10,9 @@ Pane {
 
     required property Game game
 
+    // The anticheat warning below needs a final answer
+    Component.onCompleted: game.finishDetection()
+
     FontInfo {
         id: fontInfo
 
@@ -124,6 +124,7 @@ RowLayout {
 
                 ToolButton {
                     icon.color: palette.buttonText
+                    enabled: !Steam.scanning && !Heroic.scanning && !Itch.scanning
                     icon.name: "view-refresh"
                     icon.source: Qt.resolvedUrl("icons/view-refresh.svg")
 
@@ -133,6 +134,21 @@ RowLayout {
                         Itch.scanStore();
                     }
                 }
+
+                ToolButton {
+                    icon.color: palette.buttonText
+                    icon.name: "process-stop"
+                    icon.source: Qt.resolvedUrl("icons/process-stop.svg")
+                    text: "Cancel scan"
+                    visible: Steam.scanning || Heroic.scanning || Itch.scanning || CustomGames.scanning
+
+                    onClicked: {
+                        Steam.cancelScan();
+                        Heroic.cancelScan();
+                        Itch.cancelScan();
+                        CustomGames.cancelScan();
+                    }
+                }
             }
 
             Loader {
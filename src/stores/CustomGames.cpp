@@ -11,6 +11,8 @@
 #include <QUuid>
 
 #include "Aptabase.h"
+#include "JsonView.h"
+#include "ScanExecutor.h"
 #include "Wine.h"
 
 Q_LOGGING_CATEGORY(CustomGameLog, "custom")
@@ -20,7 +22,7 @@ class CustomGame : public Game
     Q_OBJECT
 
 public:
-    CustomGame(const QJsonObject &json, QObject *parent)
+    CustomGame(JsonView json, QObject *parent)
         : Game{parent}
     {
         m_id = json["id"_L1].toString();
@@ -28,16 +30,18 @@ public:
 
         m_name = json["name"_L1].toString();
         m_installDir = json["installDir"_L1].toString();
-        m_winePrefix = json["winePrefix"_L1].toString(Wine::instance()->defaultWinePrefix());
-        m_wineBinary = json["wineBinary"_L1].toString(Wine::instance()->whichWine());
+        // Games without a Wine of their own use whatever the default is at launch
+        m_winePrefix = json["winePrefix"_L1].toString();
+        m_wineBinary = json["wineBinary"_L1].toString();
+        m_defaultWine = true;
         m_cardImage = json["cardImage"_L1].toString();
         m_heroImage = json["heroImage"_L1].toString();
         m_logoImage = json["logoImage"_L1].toString();
         m_icon = json["icon"_L1].toString();
         m_logoWidth = json["logoWidth"_L1].toDouble();
         m_logoHeight = json["logoHeight"_L1].toDouble();
-        m_logoHPosition = json["logoHPosition"_L1].toVariant().value<LogoPosition>();
-        m_logoVPosition = json["logoVPosition"_L1].toVariant().value<LogoPosition>();
+        m_logoHPosition = static_cast<LogoPosition>(json["logoHPosition"_L1].toInt());
+        m_logoVPosition = static_cast<LogoPosition>(json["logoVPosition"_L1].toInt());
 
         m_type = AppType::Game;
         m_canLaunch = true;
@@ -50,15 +54,11 @@ public:
             lo.platform = Platform::Linux;
         m_executables[0] = lo;
 
-        detectGameEngine();
-        detectArchitectures();
-        detectAnticheat();
-
         m_valid = !m_installDir.isEmpty() && QFileInfo::exists(m_executables[0].executable);
     }
 
     CustomGame(const QString &name, const QString &executable, QObject *parent)
-        : CustomGame{name, executable, Wine::instance()->whichWine(), Wine::instance()->defaultWinePrefix(), parent}
+        : CustomGame{name, executable, {}, {}, parent}
     {}
 
     CustomGame(
@@ -75,6 +75,7 @@ public:
         m_canLaunch = true;
         m_wineBinary = wine;
         m_winePrefix = winePrefix;
+        m_defaultWine = true;
 
         LaunchOption lo;
         lo.executable = executable;
@@ -84,10 +85,6 @@ public:
             lo.platform = Platform::Linux;
         m_executables[0] = lo;
 
-        detectGameEngine();
-        detectArchitectures();
-        detectAnticheat();
-
         m_valid = !m_installDir.isEmpty() && QFileInfo::exists(m_executables[0].executable);
     }
 
@@ -119,6 +116,30 @@ public:
             return {};
         return m_executables.first().executable;
     }
+
+    // The game as it's stored in custom_games.json. Wine is only written out if the game has its own, so that the rest
+    // keep following the default.
+    QJsonObject toJson() const
+    {
+        QJsonObject json;
+        json["id"_L1] = m_id;
+        json["name"_L1] = m_name;
+        json["installDir"_L1] = m_installDir;
+        if (!m_winePrefix.isEmpty())
+            json["winePrefix"_L1] = m_winePrefix;
+        if (!m_wineBinary.isEmpty())
+            json["wineBinary"_L1] = m_wineBinary;
+        json["cardImage"_L1] = m_cardImage;
+        json["heroImage"_L1] = m_heroImage;
+        json["logoImage"_L1] = m_logoImage;
+        json["icon"_L1] = m_icon;
+        json["logoWidth"_L1] = m_logoWidth;
+        json["logoHeight"_L1] = m_logoHeight;
+        json["logoHPosition"_L1] = m_logoHPosition;
+        json["logoVPosition"_L1] = m_logoVPosition;
+        json["executable"_L1] = executable();
+        return json;
+    }
 };
 
 CustomGames *CustomGames::instance()
@@ -136,12 +157,27 @@ bool CustomGames::addGame(const QString &name, const QString &executable, const
 {
     if (QFileInfo fi{executable}; fi.exists() && fi.isFile())
     {
-        if (auto g = new CustomGame{name, executable, wine, winePrefix, this}; g->isValid())
+        if (auto g = new CustomGame{name, executable, wine, winePrefix, nullptr}; g->isValid())
         {
-            beginInsertRows({}, m_games.size(), m_games.size());
-            m_games.push_back(g);
-            endInsertRows();
+            m_entries.push_back(QJsonDocument{g->toJson()}.toJson(QJsonDocument::Compact));
             writeConfig();
+
+            // Nothing else knows about the game until it has been detected, so detection can have it to itself. A scan
+            // that started in the meantime has read it from the config already.
+            ScanExecutor::instance()->submit(
+                [this, g, scans = m_scans] {
+                    g->detect();
+                    QMetaObject::invokeMethod(
+                        this,
+                        [this, g, scans] {
+                            if (scans == m_scans)
+                                appendGames({g});
+                            else
+                                delete g;
+                        },
+                        Qt::QueuedConnection);
+                },
+                g->installDir());
             return true;
         }
         else
@@ -160,42 +196,56 @@ void CustomGames::deleteGame(Game *game)
     beginRemoveRows({}, idx, idx);
     m_games.removeAt(idx);
     endRemoveRows();
+
+    m_entries.removeIf([id = game->id()](const QByteArray &entry) { return JsonView{entry}["id"_L1].toString() == id; });
 }
 
 CustomGames::CustomGames()
     : Store{nullptr}
-{}
+{
+    // Games can be added before the first scan, or without one if autoscan is off
+    readConfig();
+}
 
 void CustomGames::scanStore()
 {
-    QFile m_config{QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/custom_games.json"_L1};
-    if (m_config.exists())
-    {
-        if (!m_config.open(QIODevice::ReadOnly))
-        {
-            qCWarning(CustomGameLog) << "Failed to read custom games config";
-            Aptabase::instance()->track("failed-loading-custom-games-bug");
-            return;
-        }
+    if (!readConfig())
+        return;
 
-        qCDebug(CustomGameLog) << "Scanning custom library";
-        beginResetModel();
+    const auto scan = beginScan();
+    if (!scan)
+        return;
+    ++m_scans;
 
-        for (const auto game : std::as_const(m_games))
-            game->deleteLater();
-        m_games.clear();
+    qCDebug(CustomGameLog) << "Scanning custom library";
 
-        const auto arr = QJsonDocument::fromJson(m_config.readAll()).array();
-        for (const auto &game : arr)
-        {
-            if (auto g = new CustomGame{game.toObject(), this}; g->isValid())
-                m_games.push_back(g);
-            else
-                g->deleteLater();
-        }
+    // Games are quick to build, so only detection happens on the scan executor
+    for (const auto &entry : std::as_const(m_entries))
+    {
+        auto g = new CustomGame{JsonView{entry}, nullptr};
+        scanGame(scan, [g] { return g; }, g->installDir());
+    }
+
+    endScan(scan);
+}
 
-        endResetModel();
+bool CustomGames::readConfig()
+{
+    QFile config{QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation) + "/custom_games.json"_L1};
+    if (!config.exists())
+        return false;
+    if (!config.open(QIODevice::ReadOnly))
+    {
+        qCWarning(CustomGameLog) << "Failed to read custom games config";
+        Aptabase::instance()->track("failed-loading-custom-games-bug");
+        return false;
     }
+
+    const auto data = config.readAll();
+    m_entries.clear();
+    for (const auto &game : JsonView{data})
+        m_entries.push_back(game.raw().toByteArray());
+    return true;
 }
 
 void CustomGames::writeConfig()
@@ -209,27 +259,8 @@ void CustomGames::writeConfig()
     }
 
     QJsonArray arr;
-    for (const auto game : std::as_const(m_games))
-    {
-        QJsonObject json;
-        json["id"_L1] = game->id();
-        json["name"_L1] = game->name();
-        json["installDir"_L1] = game->installDir();
-        json["winePrefix"_L1] = game->winePrefix();
-        json["wineBinary"_L1] = game->wineBinary();
-        json["cardImage"_L1] = game->cardImage();
-        json["heroImage"_L1] = game->heroImage();
-        json["logoImage"_L1] = game->logoImage();
-        json["icon"_L1] = game->icon();
-        json["logoWidth"_L1] = game->logoWidth();
-        json["logoHeight"_L1] = game->logoHeight();
-        json["logoHPosition"_L1] = game->logoHPosition();
-        json["logoVPosition"_L1] = game->logoVPosition();
-        if (const auto cg = dynamic_cast<CustomGame *>(game); cg)
-            json["executable"_L1] = cg->executable();
-
-        arr.push_back(json);
-    }
+    for (const auto &entry : std::as_const(m_entries))
+        arr.push_back(QJsonDocument::fromJson(entry).object());
 
     m_config.write(QJsonDocument{arr}.toJson());
     m_config.close();
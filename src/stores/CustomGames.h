@@ -24,5 +24,13 @@ private:
     ~CustomGames() = default;
 
     void scanStore() final;
+    // Loads custom_games.json into m_entries. Returns false if there isn't one or it can't be read.
+    bool readConfig();
     void writeConfig();
+
+    // Every game in custom_games.json, each as its own JSON object. This is what gets written back rather than m_games,
+    // which is missing any games that a scan hasn't finished detecting yet or that aren't on disk right now.
+    QList<QByteArray> m_entries;
+    // Counts scans, so that a game added while one starts doesn't show up twice
+    int m_scans = 0;
 };
@@ -2,21 +2,112 @@
 
 #include <QDir>
 #include <QDirIterator>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QFileInfo>
 #include <QLoggingCategory>
+#include <QMap>
+#include <QSet>
 #include <QSettings>
 #include <QStandardPaths>
 
 #include "DownloadManager.h"
+#include "JsonView.h"
+#include "ScanExecutor.h"
 
 Q_LOGGING_CATEGORY(HeroicLog, "heroic")
 
 namespace
 {
-    QJsonArray amazonLibraryCache;
-}
+    // The image URL templates the GOG store cache has for a game
+    struct GogImages
+    {
+        QString verticalCover;
+        QString logo;
+        QString squareIcon;
+    };
+
+    struct AmazonProduct
+    {
+        QString title;
+        QString iconUrl;
+        QString backgroundUrl;
+    };
+
+    // Everything in Heroic's config that's shared between games, read once per scan so that games don't each have to go
+    // and parse it again
+    struct HeroicScanContext
+    {
+        QString heroicRoot;
+        // GOG id -> images from store_cache/gog_api_info.json
+        QHash<QString, GogImages> gogImages;
+        // Amazon product id -> the product from Nile's library.json
+        QHash<QString, AmazonProduct> amazonProducts;
+        // Epic app names that have a file in legendaryConfig/legendary/metadata
+        QSet<QString> legendaryMetadata;
+        // Game ids that have a file in GamesConfig
+        QSet<QString> gamesConfigs;
+        // File name -> path for everything in icons. Icons are named after the game's id, so the one for a game is the
+        // first file name that starts with it.
+        QMap<QString, QString> icons;
+
+        explicit HeroicScanContext(const QString &root)
+            : heroicRoot{root}
+        {
+            // Both of these run to megabytes for big libraries, and only a few fields of each entry are wanted
+            if (QFile gogApiInfoFile{heroicRoot + "/store_cache/gog_api_info.json"_L1};
+                gogApiInfoFile.open(QIODevice::ReadOnly))
+            {
+                const auto data = gogApiInfoFile.readAll();
+                const JsonView info{data};
+                for (auto it = info.begin(); it != info.end(); ++it)
+                {
+                    if (const auto key = it.key(); key.startsWith("gog_"_L1))
+                    {
+                        const auto game = it.value()["game"_L1];
+                        gogImages.insert(key.sliced(4),
+                                         {game["vertical_cover"_L1]["url_format"_L1].toString(),
+                                          game["logo"_L1]["url_format"_L1].toString(),
+                                          game["square_icon"_L1]["url_format"_L1].toString()});
+                    }
+                }
+            }
+
+            if (QFile amazonLibraryFile{heroicRoot + "/nile_config/nile/library.json"_L1};
+                amazonLibraryFile.open(QIODevice::ReadOnly))
+            {
+                const auto data = amazonLibraryFile.readAll();
+                for (const auto &entry : JsonView{data})
+                {
+                    const auto product = entry["product"_L1];
+                    const auto productDetail = product["productDetail"_L1];
+                    amazonProducts.insert(product["id"_L1].toString(),
+                                          {product["title"_L1].toString(),
+                                           productDetail["iconUrl"_L1].toString(),
+                                           productDetail["details"_L1]["backgroundUrl2"_L1].toString()});
+                }
+            }
+
+            const auto listIds = [](const QString &dir, QSet<QString> &ids) {
+                for (const auto &file : QDir{dir}.entryList({"*.json"_L1}, QDir::Files))
+                    ids.insert(file.chopped(5));
+            };
+            listIds(heroicRoot + "/legendaryConfig/legendary/metadata"_L1, legendaryMetadata);
+            listIds(heroicRoot + "/GamesConfig"_L1, gamesConfigs);
+
+            for (QDirIterator it{heroicRoot + "/icons"_L1, QDir::Files}; it.hasNext();)
+            {
+                const auto path = it.next();
+                icons.insert(it.fileName(), path);
+            }
+        }
+    };
+
+    // Heroic keeps installs side by side, so the directory around one stands in for the library it's in
+    QString libraryOf(const QString &installPath)
+    {
+        return installPath.isEmpty() ? QString{} : QFileInfo{installPath}.path();
+    }
+} // namespace
 
 class HeroicGame : public Game
 {
@@ -30,7 +121,7 @@ public:
         Amazon,
     };
 
-    HeroicGame(SubStore store, const QJsonObject &json, QObject *parent = nullptr)
+    HeroicGame(SubStore store, JsonView json, const HeroicScanContext &context, QObject *parent = nullptr)
         : Game{parent}
     {
         if (store == SubStore::Epic)
@@ -47,24 +138,22 @@ public:
             // https://github.com/Heroic-Games-Launcher/HeroicGamesLauncher/blob/d2f0ed1c3929c78fc35b58e54bad1ccdfd5d8ed8/src/common/types/legendary.ts#L6
             // (check for updated version if Epic ever adds Linux support, I guess)
             // We are skipping Android and iOS for now, but can add those if it ever becomes a problem
-            if (const auto platform = json["platform"].toString(); platform == "Windows"_L1 || platform == "Win32"_L1)
+            if (const auto platform = json["platform"_L1].toString(); platform == "Windows"_L1 || platform == "Win32"_L1)
                 lo.platform = Platform::Windows;
             else if (platform == "Mac"_L1)
                 lo.platform = Platform::MacOS;
 
             m_executables[m_executables.size()] = lo;
 
-            if (QFile metadataFile{Heroic::instance()->storeRoot() +
-                                   "/legendaryConfig/legendary/metadata/%1.json"_L1.arg(m_id)};
-                metadataFile.open(QIODevice::ReadOnly))
+            if (QFile metadataFile{context.heroicRoot + "/legendaryConfig/legendary/metadata/%1.json"_L1.arg(m_id)};
+                context.legendaryMetadata.contains(m_id) && metadataFile.open(QIODevice::ReadOnly))
             {
-                const auto metadata = QJsonDocument::fromJson(metadataFile.readAll());
-
-                for (const auto &image : metadata["metadata"_L1]["keyImages"_L1].toArray())
+                const auto data = metadataFile.readAll();
+                for (const auto &image : JsonView{data}["metadata"_L1]["keyImages"_L1])
                 {
-                    if (image["type"_L1] == "DieselGameBox"_L1)
+                    if (const auto type = image["type"_L1].toString(); type == "DieselGameBox"_L1)
                         m_heroImage = "image://heroic-image/"_L1 + image["url"_L1].toString();
-                    else if (image["type"_L1] == "DieselGameBoxTall"_L1)
+                    else if (type == "DieselGameBoxTall"_L1)
                         m_cardImage = "image://heroic-image/"_L1 + image["url"_L1].toString();
                 }
             }
@@ -76,18 +165,19 @@ public:
 
             if (QFile gogGameInfo{"%1/goggame-%2.info"_L1.arg(m_installDir, m_id)}; gogGameInfo.open(QIODevice::ReadOnly))
             {
-                const auto info = QJsonDocument::fromJson(gogGameInfo.readAll()).object();
+                const auto data = gogGameInfo.readAll();
+                const JsonView info{data};
                 m_name = info["name"_L1].toString();
 
                 Platform platform;
-                if (const auto p = json["platform"].toString(); p == "windows"_L1)
+                if (const auto p = json["platform"_L1].toString(); p == "windows"_L1)
                     platform = Platform::Windows;
                 else if (p == "osx"_L1)
                     platform = Platform::MacOS;
                 else if (p == "linux"_L1)
                     platform = Platform::Linux;
 
-                for (const auto &entry : info["playTasks"_L1].toArray())
+                for (const auto &entry : info["playTasks"_L1])
                 {
                     LaunchOption lo;
                     lo.executable = m_installDir + '/' + entry["path"_L1].toString();
@@ -103,23 +193,15 @@ public:
                 }
             }
 
-            if (QFile storeCacheFile{Heroic::instance()->storeRoot() + "/store_cache/gog_api_info.json"};
-                storeCacheFile.open(QIODevice::ReadOnly))
+            if (const auto it = context.gogImages.constFind(m_id); it != context.gogImages.cend())
             {
-                auto storeCache = QJsonDocument::fromJson(storeCacheFile.readAll())["gog_%1"_L1.arg(m_id)];
-
-                m_cardImage = "image://heroic-image/"_L1 + storeCache["game"_L1]["vertical_cover"_L1]["url_format"_L1]
-                                                               .toString()
-                                                               .replace("{formatter}"_L1, ""_L1)
-                                                               .replace("{ext}"_L1, "jpg"_L1);
-                m_heroImage = "image://heroic-image/"_L1 + storeCache["game"_L1]["logo"_L1]["url_format"_L1]
-                                                               .toString()
-                                                               .replace("{formatter}"_L1, ""_L1)
-                                                               .replace("{ext}"_L1, "jpg"_L1);
-                m_icon = "image://heroic-image/"_L1 + storeCache["game"_L1]["square_icon"_L1]["url_format"_L1]
-                                                          .toString()
-                                                          .replace("{formatter}"_L1, ""_L1)
-                                                          .replace("{ext}"_L1, "jpg"_L1);
+                const auto image = [](QString urlFormat) {
+                    return "image://heroic-image/"_L1 +
+                           urlFormat.replace("{formatter}"_L1, ""_L1).replace("{ext}"_L1, "jpg"_L1);
+                };
+                m_cardImage = image(it->verticalCover);
+                m_heroImage = image(it->logo);
+                m_icon = image(it->squareIcon);
             }
         }
         else if (store == SubStore::Amazon)
@@ -128,25 +210,22 @@ public:
             m_installDir = json["path"_L1].toString();
             m_type = AppType::Game;
 
-            if (const auto it =
-                    std::find_if(amazonLibraryCache.cbegin(),
-                                 amazonLibraryCache.cend(),
-                                 [this](const QJsonValueConstRef v) { return v["product"_L1]["id"_L1] == m_id; });
-                it != amazonLibraryCache.cend())
+            if (const auto it = context.amazonProducts.constFind(m_id); it != context.amazonProducts.cend())
             {
-                const auto info = it->toObject();
-                const auto &product = info["product"_L1];
-
-                m_name = product["title"_L1].toString();
-
-                m_cardImage = "image://heroic-image/"_L1 + product["productDetail"_L1]["iconUrl"_L1].toString();
-                m_heroImage =
-                    "image://heroic-image/"_L1 + product["productDetail"_L1]["details"_L1]["backgroundUrl2"_L1].toString();
+                m_name = it->title;
+                m_cardImage = "image://heroic-image/"_L1 + it->iconUrl;
+                m_heroImage = "image://heroic-image/"_L1 + it->backgroundUrl;
+            }
+            else
+            {
+                // Nile's library can be missing or out of date, which shouldn't hide games that are installed
+                m_name = QFileInfo{m_installDir}.fileName();
             }
 
             if (QFile fuelJson{m_installDir + "/fuel.json"_L1}; fuelJson.open(QIODevice::ReadOnly))
             {
-                const auto fuel = QJsonDocument::fromJson(fuelJson.readAll());
+                const auto data = fuelJson.readAll();
+                const JsonView fuel{data};
 
                 LaunchOption lo;
                 lo.platform = Platform::Windows;
@@ -158,11 +237,15 @@ public:
         // Kinda weird to have this here, but it doesn't work well anywhere else
         qCDebug(HeroicLog) << "Creating game:" << m_id;
 
+        // Legendary, gogdl and nile all record the installed version
+        m_installVersion = json["version"_L1].toString();
+
         // Common to all substores
-        if (QFile gamesConfig{Heroic::instance()->storeRoot() + "/GamesConfig/%1.json"_L1.arg(m_id)};
-            gamesConfig.open(QIODevice::ReadOnly))
+        if (QFile gamesConfig{context.heroicRoot + "/GamesConfig/%1.json"_L1.arg(m_id)};
+            context.gamesConfigs.contains(m_id) && gamesConfig.open(QIODevice::ReadOnly))
         {
-            const auto installationInfo = QJsonDocument::fromJson(gamesConfig.readAll())[m_id];
+            const auto data = gamesConfig.readAll();
+            const auto installationInfo = JsonView{data}[m_id];
 
             m_winePrefix = installationInfo["winePrefix"_L1].toString();
             m_wineBinary = installationInfo["wineVersion"_L1]["bin"_L1].toString();
@@ -183,20 +266,8 @@ public:
         }
 
         // Fall back to local icon cache if it exists to avoid loading from the network
-        QDirIterator icons{Heroic::instance()->storeRoot() + "/icons"_L1};
-        while (icons.hasNext())
-        {
-            icons.next();
-            if (icons.fileName().startsWith(m_id))
-            {
-                m_icon = "file://"_L1 + icons.filePath();
-                break;
-            }
-        }
-
-        detectGameEngine();
-        detectArchitectures();
-        detectAnticheat();
+        if (const auto icon = context.icons.lowerBound(m_id); icon != context.icons.cend() && icon.key().startsWith(m_id))
+            m_icon = "file://"_L1 + icon.value();
 
         m_valid = m_executables.size() > 0;
     }
@@ -244,13 +315,21 @@ void Heroic::scanStore()
 {
     if (m_heroicRoot.isEmpty())
         return;
+    const auto scan = beginScan();
+    if (!scan)
+        return;
 
     qCDebug(HeroicLog) << "Scanning Heroic library";
-    beginResetModel();
+    ScanExecutor::instance()->submit([this, scan] { scanLibrary(scan); });
+}
 
-    for (const auto game : std::as_const(m_games))
-        game->deleteLater();
-    m_games.clear();
+void Heroic::scanLibrary(const std::shared_ptr<Scan> &scan)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto context = std::make_shared<const HeroicScanContext>(m_heroicRoot);
+    qsizetype gameCount = 0;
 
     // Here begins a three-part journey.
     // Part the first: Epic
@@ -258,13 +337,16 @@ void Heroic::scanStore()
         epicInstalled.open(QIODevice::ReadOnly))
     {
         qCDebug(HeroicLog) << "Found Epic:" << epicInstalled.fileName();
-        const auto epicJson = QJsonDocument::fromJson(epicInstalled.readAll()).object();
-        for (const auto &game : epicJson)
+        const auto data = epicInstalled.readAll();
+        for (const auto &game : JsonView{data})
         {
-            if (auto g = new HeroicGame{HeroicGame::SubStore::Epic, game.toObject(), this}; g->isValid())
-                m_games.push_back(g);
-            else
-                g->deleteLater();
+            // Each game keeps a copy of just its own entry, since it's read on another thread after this is gone
+            scanGame(scan,
+                     [json = game.raw().toByteArray(), context] {
+                         return new HeroicGame{HeroicGame::SubStore::Epic, JsonView{json}, *context};
+                     },
+                     libraryOf(game["install_path"_L1].toString()));
+            ++gameCount;
         }
     }
 
@@ -272,36 +354,37 @@ void Heroic::scanStore()
     if (QFile gogInstalled{m_heroicRoot + "/gog_store/installed.json"_L1}; gogInstalled.open(QIODevice::ReadOnly))
     {
         qCDebug(HeroicLog) << "Found GOG:" << gogInstalled.fileName();
-        const auto gogJson = QJsonDocument::fromJson(gogInstalled.readAll()).object();
-        for (const auto &game : gogJson["installed"_L1].toArray())
+        const auto data = gogInstalled.readAll();
+        for (const auto &game : JsonView{data}["installed"_L1])
         {
-            if (auto g = new HeroicGame{HeroicGame::SubStore::GOG, game.toObject(), this}; g->isValid())
-                m_games.push_back(g);
-            else
-                g->deleteLater();
+            scanGame(scan,
+                     [json = game.raw().toByteArray(), context] {
+                         return new HeroicGame{HeroicGame::SubStore::GOG, JsonView{json}, *context};
+                     },
+                     libraryOf(game["install_path"_L1].toString()));
+            ++gameCount;
         }
     }
 
     // Part the third: Amazon
-    if (QFile amazonLibrary{m_heroicRoot + "/nile_config/nile/library.json"_L1}; amazonLibrary.open(QIODevice::ReadOnly))
+    if (QFile amazonInstalled{m_heroicRoot + "/nile_config/nile/installed.json"_L1};
+        amazonInstalled.open(QIODevice::ReadOnly))
     {
-        amazonLibraryCache = QJsonDocument::fromJson(amazonLibrary.readAll()).array();
-        if (QFile amazonInstalled{m_heroicRoot + "/nile_config/nile/installed.json"_L1};
-            amazonInstalled.open(QIODevice::ReadOnly))
+        qCDebug(HeroicLog) << "Found Amazon:" << amazonInstalled.fileName();
+        const auto data = amazonInstalled.readAll();
+        for (const auto &game : JsonView{data})
         {
-            qCDebug(HeroicLog) << "Found Amazon:" << amazonInstalled.fileName();
-            const auto amazonJson = QJsonDocument::fromJson(amazonInstalled.readAll()).array();
-            for (const auto &game : amazonJson)
-            {
-                if (auto g = new HeroicGame{HeroicGame::SubStore::Amazon, game.toObject(), this}; g->isValid())
-                    m_games.push_back(g);
-                else
-                    g->deleteLater();
-            }
+            scanGame(scan,
+                     [json = game.raw().toByteArray(), context] {
+                         return new HeroicGame{HeroicGame::SubStore::Amazon, JsonView{json}, *context};
+                     },
+                     libraryOf(game["path"_L1].toString()));
+            ++gameCount;
         }
     }
 
-    endResetModel();
+    endScan(scan);
+    qCDebug(HeroicLog) << "Read" << gameCount << "Heroic games in" << timer.elapsed() << "ms";
 }
 
 class HeroicImageFetcher : public QQuickImageResponse
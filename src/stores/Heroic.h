@@ -23,6 +23,8 @@ private:
     ~Heroic() = default;
 
     void scanStore() final;
+    // Runs on the scan executor
+    void scanLibrary(const std::shared_ptr<Scan> &scan);
 
     QString m_heroicRoot;
 };
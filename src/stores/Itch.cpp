@@ -1,62 +1,88 @@
 #include "Itch.h"
 
+#include <atomic>
+
+#include <zlib.h>
+
 #include <QDir>
 #include <QDirIterator>
-#include <QJsonArray>
-#include <QJsonDocument>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
-#include <QProcess>
 #include <QSqlDatabase>
+#include <QSqlError>
 #include <QSqlQuery>
 #include <QStandardPaths>
-#include <QTemporaryDir>
 
 #include "Aptabase.h"
 #include "DownloadManager.h"
-#include "Wine.h"
+#include "JsonView.h"
+#include "ScanExecutor.h"
 
 Q_LOGGING_CATEGORY(ItchLog, "itch")
 
 namespace
 {
-    QSqlDatabase ITCH_DB;
-}
+    // What butler.db knows about an install. Butler calls installs caves.
+    struct ItchCave
+    {
+        struct Candidate
+        {
+            QString path; // Relative to the install dir
+            Game::Platform platform;
+        };
+
+        QDateTime lastTouched;
+        QList<Candidate> candidates;
+    };
+
+    // Everything a scan reads once and shares between games
+    struct ItchScanContext
+    {
+        // Itch game id -> cave
+        QHash<QString, ItchCave> caves;
+    };
+
+    // Returns nothing if the file is missing or its contents are corrupt
+    QByteArray readGzipFile(const QString &path)
+    {
+        const auto file = gzopen(QFile::encodeName(path).constData(), "rb");
+        if (!file)
+            return {};
+
+        QByteArray data;
+        char buffer[16 * 1024];
+        int read;
+        while ((read = gzread(file, buffer, sizeof buffer)) > 0)
+            data.append(buffer, read);
+
+        // A truncated file reads like one that ended early, unless the error is checked
+        auto error = Z_OK;
+        gzerror(file, &error);
+        const auto ok = read == 0 && error == Z_OK;
+        gzclose(file);
+        return ok ? data : QByteArray{};
+    }
+} // namespace
 
 class ItchGame : public Game
 {
     Q_OBJECT
 
 public:
-    ItchGame(const QString &installPath, QObject *parent)
+    ItchGame(const QString &installPath, const ItchScanContext &context, QObject *parent)
         : Game{parent}
     {
         qCDebug(ItchLog) << "Creating game:" << installPath;
 
-        QTemporaryDir tempDir;
-        if (!tempDir.isValid())
-        {
-            qCWarning(ItchLog) << "Failed to create temporary directory";
-            Aptabase::instance()->track("itch-failed-tempdir-bug"_L1);
-            return;
-        }
-
-        const QString zipPath = installPath + "/.itch/receipt.json.gz"_L1;
-        QProcess unzipJsonProc;
-        unzipJsonProc.setWorkingDirectory(tempDir.path());
-        QStringList args;
-        args << "-c"_L1 << zipPath;
-        unzipJsonProc.start("gunzip"_L1, args);
-        unzipJsonProc.waitForFinished();
-        if (unzipJsonProc.exitCode() != 0)
+        const auto receipt = readGzipFile(installPath + "/.itch/receipt.json.gz"_L1);
+        if (receipt.isEmpty())
         {
-            qCWarning(ItchLog) << "Unzip Itch info failed:" << unzipJsonProc.errorString();
-            qCWarning(ItchLog) << unzipJsonProc.readAllStandardError();
+            qCWarning(ItchLog) << "Could not read Itch receipt for" << installPath;
             Aptabase::instance()->track("itch-failed-unzip-bug"_L1);
             return;
         }
 
-        const auto json = QJsonDocument::fromJson(unzipJsonProc.readAllStandardOutput());
-        const auto game = json["game"_L1].toObject();
+        const auto game = JsonView{receipt}["game"_L1];
 
         m_id = QString::number(game["id"_L1].toInt());
         m_name = game["title"_L1].toString();
@@ -65,10 +91,10 @@ public:
         m_heroImage = m_cardImage;
         m_icon = m_cardImage;
 
-        m_wineBinary = Wine::instance()->whichWine();
-        m_winePrefix = Wine::instance()->defaultWinePrefix();
+        // Itch doesn't manage Wine, so games run with whatever the default is at launch
+        m_defaultWine = true;
 
-        if (const auto type = game["classification"_L1]; type == "game"_L1)
+        if (const auto type = game["classification"_L1].toString(); type == "game"_L1)
             m_type = Game::AppType::Game;
         // Itch refers to generic apps as tools, but we normally use Tools for things like Proton
         else if (type == "tool"_L1)
@@ -76,25 +102,15 @@ public:
         else if (type == "soundtrack"_L1)
             m_type = Game::AppType::Music;
 
-        if (ITCH_DB.isValid())
+        if (const auto cave = context.caves.constFind(m_id); cave != context.caves.cend())
         {
-            if (QSqlQuery q; q.exec("SELECT last_touched_at, verdict FROM caves WHERE game_id='%1'"_L1.arg(m_id)))
+            m_lastPlayed = cave->lastTouched;
+            for (const auto &candidate : cave->candidates)
             {
-                q.first();
-                m_lastPlayed = QDateTime::fromString(q.value(0).toString(), Qt::ISODateWithMs);
-
-                const auto verdict = QJsonDocument::fromJson(q.value(1).toByteArray()).object();
-                const auto &candidates = verdict["candidates"_L1].toArray();
-                for (const auto &candidate : candidates)
-                {
-                    LaunchOption lo;
-                    lo.executable = m_installDir + '/' + candidate["path"_L1].toString();
-                    if (const auto flavor = candidate["flavor"_L1].toString(); flavor == "linux"_L1)
-                        lo.platform = Platform::Linux;
-                    else if (flavor == "html"_L1)
-                        continue; // skip these as executables
-                    m_executables[0] = lo;
-                }
+                LaunchOption lo;
+                lo.executable = m_installDir + '/' + candidate.path;
+                lo.platform = candidate.platform;
+                m_executables[0] = lo;
             }
         }
 
@@ -132,10 +148,6 @@ public:
             }
         }
 
-        detectGameEngine();
-        detectArchitectures();
-        detectAnticheat();
-
         m_valid = m_executables.size() > 0;
     }
 
@@ -177,21 +189,73 @@ void Itch::scanStore()
 {
     if (m_itchRoot.isEmpty())
         return;
+    const auto scan = beginScan();
+    if (!scan)
+        return;
 
     qCDebug(ItchLog) << "Scanning Itch library";
-    beginResetModel();
+
+    ScanExecutor::instance()->submit([this, scan] { scanLibrary(scan); });
+}
+
+void Itch::scanLibrary(const std::shared_ptr<Scan> &scan)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const auto context = std::make_shared<ItchScanContext>();
 
     QStringList installLocations;
 
-    const auto dbPath = m_itchRoot + "/db/butler.db"_L1;
-    if (!ITCH_DB.isValid() && QFileInfo::exists(dbPath))
+    if (const auto dbPath = m_itchRoot + "/db/butler.db"_L1; QFileInfo::exists(dbPath))
     {
-        ITCH_DB = QSqlDatabase::addDatabase("QSQLITE"_L1);
-        ITCH_DB.setDatabaseName(dbPath);
-        if (ITCH_DB.open())
-            if (QSqlQuery q; q.exec("SELECT path FROM install_locations"_L1))
-                while (q.next())
-                    installLocations.push_back(q.value(0).toString());
+        // butler.db belongs to the itch app, which may well be running, so it only gets read. SQLite connections can only
+        // be used on the thread that opened them, so every scan opens its own.
+        static std::atomic_int connectionCount = 0;
+        const auto connectionName = "itch-scan-%1"_L1.arg(QString::number(connectionCount++));
+        {
+            auto db = QSqlDatabase::addDatabase("QSQLITE"_L1, connectionName);
+            db.setDatabaseName(dbPath);
+            db.setConnectOptions("QSQLITE_OPEN_READONLY"_L1);
+            if (db.open())
+            {
+                QSqlQuery q{db};
+                q.setForwardOnly(true);
+
+                if (q.exec("SELECT path FROM install_locations"_L1))
+                    while (q.next())
+                        installLocations.push_back(q.value(0).toString());
+
+                // Every installed game needs its cave, so they're all read at once
+                if (q.exec("SELECT game_id, last_touched_at, verdict FROM caves"_L1))
+                {
+                    while (q.next())
+                    {
+                        ItchCave cave;
+                        cave.lastTouched = QDateTime::fromString(q.value(1).toString(), Qt::ISODateWithMs);
+
+                        const auto verdict = q.value(2).toByteArray();
+                        for (const auto &candidate : JsonView{verdict}["candidates"_L1])
+                        {
+                            const auto flavor = candidate["flavor"_L1].toString();
+                            if (flavor == "html"_L1)
+                                continue; // skip these as executables
+                            cave.candidates.push_back({candidate["path"_L1].toString(),
+                                                       flavor == "linux"_L1 ? Game::Platform::Linux
+                                                                            : Game::Platform::Windows});
+                        }
+
+                        // A game can be installed more than once; the first cave wins
+                        context->caves.try_emplace(q.value(0).toString(), std::move(cave));
+                    }
+                }
+                else
+                    qCWarning(ItchLog) << "Could not read caves from butler.db:" << q.lastError().text();
+            }
+            else
+                qCWarning(ItchLog) << "Could not open butler.db:" << db.lastError().text();
+        }
+        QSqlDatabase::removeDatabase(connectionName);
     }
 
     if (installLocations.isEmpty())
@@ -200,27 +264,24 @@ void Itch::scanStore()
         installLocations.append(m_itchRoot + "/apps"_L1);
     }
 
-    for (const auto game : std::as_const(m_games))
-        game->deleteLater();
-    m_games.clear();
-
-    for (const auto &location : installLocations)
+    qsizetype gameCount = 0;
+    for (const auto &location : std::as_const(installLocations))
     {
-        QDirIterator apps{location};
+        QDirIterator apps{location, QDir::Dirs | QDir::NoDotAndDotDot};
         while (apps.hasNext())
         {
-            apps.next();
-            if (apps.fileName() == "downloads"_L1 || apps.fileName() == "."_L1 || apps.fileName() == ".."_L1)
+            const auto path = apps.next();
+            if (apps.fileName() == "downloads"_L1)
                 continue;
 
-            if (auto g = new ItchGame{apps.filePath(), this}; g->isValid())
-                m_games.push_back(g);
-            else
-                g->deleteLater();
+            scanGame(scan, [path, context] { return new ItchGame{path, *context, nullptr}; }, location);
+            ++gameCount;
         }
     }
 
-    endResetModel();
+    endScan(scan);
+    qCDebug(ItchLog) << "Read" << context->caves.size() << "caves and" << gameCount << "Itch installs in"
+                     << timer.elapsed() << "ms";
 }
 
 class ItchImageFetcher : public QQuickImageResponse
@@ -22,6 +22,8 @@ private:
     ~Itch() = default;
 
     void scanStore() final;
+    // Runs on the scan executor
+    void scanLibrary(const std::shared_ptr<Scan> &scan);
 
     QString m_itchRoot;
 };
@@ -3,21 +3,59 @@
 #include <QDesktopServices>
 #include <QDir>
 #include <QDirIterator>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QSet>
 #include <QSettings>
 
 #include "Aptabase.h"
-#include "VDF.h"
+#include "ScanExecutor.h"
+#include "SteamAppInfo.h"
 #include "vdf_parser.hpp"
 
 Q_LOGGING_CATEGORY(SteamLog, "steam")
 
+namespace
+{
+    // Every image Steam has cached for the library, listed once per scan so that games don't each have to go looking
+    struct SteamImageIndex
+    {
+        // appid -> file name -> path, for everything under appcache/librarycache/<appid>
+        QHash<QString, QHash<QString, QString>> libraryCache;
+        // File names in steam/games
+        QSet<QString> gameIcons;
+
+        explicit SteamImageIndex(const QString &steamRoot)
+        {
+            const auto libraryCacheDir = steamRoot + "/appcache/librarycache"_L1;
+            for (QDirIterator it{libraryCacheDir, QDir::Files, QDirIterator::Subdirectories}; it.hasNext();)
+            {
+                const auto path = it.next();
+                const auto relative = QStringView{path}.mid(libraryCacheDir.size() + 1);
+                const auto slash = relative.indexOf('/');
+                if (slash <= 0)
+                    continue;
+
+                // Games can have the same image more than once in subdirectories; the first one found wins
+                libraryCache[relative.first(slash).toString()].try_emplace(it.fileName(), path);
+            }
+
+            for (const auto &icon : QDir{steamRoot + "/steam/games"_L1}.entryList(QDir::Files))
+                gameIcons.insert(icon);
+        }
+    };
+} // namespace
+
 class SteamGame : public Game
 {
     Q_OBJECT
 
 public:
-    SteamGame(const QString &steamId, const QString &steamDrive, QObject *parent)
+    SteamGame(const QString &steamId,
+              const QString &steamDrive,
+              const SteamAppInfo &appInfo,
+              const SteamImageIndex &imageIndex,
+              QObject *parent)
         : Game{parent}
     {
         qCDebug(SteamLog) << "Creating game:" << steamId;
@@ -37,6 +75,9 @@ public:
                 m_installDir = steamDrive + "/steamapps/common/"_L1 + installDir;
             if (app.attribs.contains("LastPlayed"))
                 m_lastPlayed = QDateTime::fromSecsSinceEpoch(std::stoi(app.attribs["LastPlayed"]));
+            if (app.attribs.contains("buildid"))
+                m_installVersion = "%1:%2"_L1.arg(QString::fromStdString(app.attribs["buildid"]),
+                                                  QString::fromStdString(app.attribs["LastUpdated"]));
         }
         catch (const std::length_error &e)
         {
@@ -44,19 +85,16 @@ public:
             return;
         }
 
-        const auto imageDir = Steam::instance()->storeRoot() + "/appcache/librarycache/"_L1 + m_id;
-        QDirIterator images{imageDir, QDirIterator::Subdirectories};
-        while (images.hasNext())
-        {
-            images.next();
-            if ((images.fileName() == "library_600x900.jpg"_L1 || images.fileName() == "library_capsule.jpg"_L1) &&
-                m_cardImage.isEmpty())
-                m_cardImage = "file://"_L1 + images.filePath();
-            else if (images.fileName() == "library_hero.jpg"_L1 && m_heroImage.isEmpty())
-                m_heroImage = "file://"_L1 + images.filePath();
-            else if (images.fileName() == "logo.png"_L1 && m_logoImage.isEmpty())
-                m_logoImage = "file://"_L1 + images.filePath();
-        }
+        const auto images = imageIndex.libraryCache.value(m_id);
+        const auto findImage = [&images](const QString &fileName) {
+            const auto path = images.value(fileName);
+            return path.isEmpty() ? path : "file://"_L1 + path;
+        };
+        m_cardImage = findImage("library_600x900.jpg"_L1);
+        if (m_cardImage.isEmpty())
+            m_cardImage = findImage("library_capsule.jpg"_L1);
+        m_heroImage = findImage("library_hero.jpg"_L1);
+        m_logoImage = findImage("logo.png"_L1);
 
         QString compatdata = steamDrive + "/steamapps/compatdata/"_L1 + m_id;
         m_winePrefix = compatdata + "/pfx"_L1;
@@ -81,158 +119,73 @@ public:
             }
         }
 
-        auto *info = AppInfoVDF::instance()->game(m_id.toInt());
-        AppInfoVDF::AppInfo::Section section;
-        AppInfoVDF::AppInfo::SectionDesc app_desc{};
-
-        app_desc.blob = info->getRootSection(&app_desc.size);
-        section.parse(app_desc);
-
-        constexpr auto parseInt = [](const auto type, const auto &value) -> int64_t {
-            switch (type)
-            {
-            case AppInfoVDF::AppInfo::Section::Int32:
-                return *static_cast<int32_t *>(value);
-            case AppInfoVDF::AppInfo::Section::Int64:
-                return *static_cast<int64_t *>(value);
-            case AppInfoVDF::AppInfo::Section::String:
-                return std::stoi(static_cast<char *>(value));
-            default:
-                return 0;
-            }
-        };
-
-        constexpr auto parseDouble = [](const auto type, const auto &value) -> int64_t {
-            switch (type)
-            {
-            case AppInfoVDF::AppInfo::Section::Int32:
-                return *static_cast<int32_t *>(value);
-            case AppInfoVDF::AppInfo::Section::Int64:
-                return *static_cast<int64_t *>(value);
-            case AppInfoVDF::AppInfo::Section::String:
-                return std::stod(static_cast<char *>(value));
-            default:
-                return 0;
-            }
-        };
+        if (m_name.isEmpty())
+            m_name = appInfo.name;
+        if (m_installDir.isEmpty() && !appInfo.installDir.isEmpty())
+            m_installDir = steamDrive + "/steamapps/common/"_L1 + appInfo.installDir;
+
+        if (const auto type = appInfo.type.toLower(); type == "game"_L1 || type == "beta"_L1)
+            m_type = AppType::Game;
+        else if (type == "application"_L1)
+            m_type = AppType::App;
+        else if (type == "tool"_L1)
+            m_type = AppType::Tool;
+        else if (type == "demo"_L1)
+            m_type = AppType::Demo;
+        else if (type == "music"_L1)
+            m_type = AppType::Music;
+
+        for (const auto &logoId : appInfo.iconIds)
+        {
+            // We prefer to use the .jpg but will fall back to the .ico if the .jpg is available
+            if (const auto jpg = findImage(logoId + ".jpg"_L1); !jpg.isEmpty())
+                m_icon = jpg;
+            else if (const auto ico = logoId + ".ico"_L1; imageIndex.gameIcons.contains(ico) && !m_icon.isEmpty())
+                m_icon = "file://%1/steam/games/%2"_L1.arg(Steam::instance()->storeRoot(), ico);
+        }
 
-        for (auto &section : section.finished_sections)
+        if (appInfo.vrSupport)
+            m_features.setFlag(Feature::VR);
+        if (appInfo.vrOnly)
         {
-            if (section.name.startsWith("appinfo.config.launch."_L1))
-            {
-                int id = section.name.split('.').at(3).toInt();
-                if (!m_executables.contains(id))
-                    m_executables[id] = {};
-                for (const auto &[key, value] : std::as_const(section.keys))
-                {
-                    if (key == "executable"_L1)
-                        m_executables[id].executable = m_installDir + '/' + static_cast<const char *>(value.second);
-                    else if (key == "type"_L1)
-                    {
-                        if (QString type{static_cast<const char *>(value.second)}; type == "vr" || type == "openxr")
-                            m_features.setFlag(Feature::VR);
-                    }
-                    else if (key == "oslist"_L1)
-                    {
-                        const QString os = static_cast<const char *>(value.second);
-                        if (os.contains("windows"_L1))
-                            m_executables[id].platform = Platform::Windows;
-                        if (os.contains("linux"_L1))
-                            m_executables[id].platform = Platform::Linux;
-                        if (os.contains("macos"_L1))
-                            m_executables[id].platform = Platform::MacOS;
-                    }
-                }
-            }
+            m_features.setFlag(Feature::VR);
+            m_features.setFlag(Feature::Flatscreen, false);
+        }
 
-            else if (section.name == "appinfo.common.library_assets.logo_position"_L1)
-            {
-                for (const auto &[key, value] : std::as_const(section.keys))
-                {
-                    if (key == "width_pct"_L1)
-                        m_logoWidth = parseDouble(value.first, value.second);
-                    else if (key == "height_pct"_L1)
-                        m_logoHeight = parseDouble(value.first, value.second);
-                    else if (key == "pinned_position"_L1)
-                    {
-                        QString posStr = static_cast<char *>(value.second);
-                        if (posStr.startsWith("Center"_L1))
-                            m_logoVPosition = LogoPosition::Center;
-                        else if (posStr.startsWith("Top"_L1))
-                            m_logoVPosition = LogoPosition::Top;
-                        else if (posStr.startsWith("Bottom"_L1))
-                            m_logoVPosition = LogoPosition::Bottom;
-
-                        if (posStr.endsWith("Center"_L1))
-                            m_logoHPosition = LogoPosition::Center;
-                        else if (posStr.endsWith("Left"_L1))
-                            m_logoHPosition = LogoPosition::Left;
-                        else if (posStr.endsWith("Right"_L1))
-                            m_logoHPosition = LogoPosition::Right;
-                    }
-                }
-            }
-            else if (section.name == "appinfo.common")
-            {
-                for (const auto &[key, value] : std::as_const(section.keys))
-                {
-                    if (key == "name"_L1 && m_name.isEmpty())
-                        m_name = static_cast<const char *>(value.second);
-                    else if (key == "installdir"_L1 && m_installDir.isEmpty())
-                        m_installDir = steamDrive + "/steamapps/common/"_L1 + static_cast<const char *>(value.second);
-                    else if (key == "type"_L1)
-                    {
-                        QString type{static_cast<const char *>(value.second)};
-                        type = type.toLower();
-                        if (type == "game"_L1 || type == "beta"_L1)
-                            m_type = AppType::Game;
-                        else if (type == "application"_L1)
-                            m_type = AppType::App;
-                        else if (type == "tool"_L1)
-                            m_type = AppType::Tool;
-                        else if (type == "demo"_L1)
-                            m_type = AppType::Demo;
-                        else if (type == "music"_L1)
-                            m_type = AppType::Music;
-                    }
-                    else if (key == "icon"_L1 || key == "clienticon"_L1)
-                    {
-                        const QString logoId{static_cast<const char *>(value.second)};
-
-                        // We prefer to use the .jpg but will fall back to the .ico if the .jpg is available
-                        if (QFileInfo fi{
-                                u"%1/appcache/librarycache/%2/%3.jpg"_s.arg(Steam::instance()->storeRoot(), m_id, logoId)};
-                            fi.exists())
-                            m_icon = "file://"_L1 + fi.absoluteFilePath();
-                        else if (QFileInfo fi{u"%1/steam/games/%2.ico"_s.arg(Steam::instance()->storeRoot(), logoId)};
-                                 fi.exists() && !m_icon.isEmpty())
-                            m_icon = "file://"_L1 + fi.absoluteFilePath();
-                    }
-                    else if ((key == "openvrsupport"_L1 || key == "openxrsupport"_L1) && !m_features.testFlag(Feature::VR))
-                        m_features.setFlag(Feature::VR, parseInt(value.first, value.second));
-                    else if (key == "onlyvrsupport"_L1 && !m_features.testFlag(Feature::VR))
-                    {
-                        if (bool vrOnly = parseInt(value.first, value.second); vrOnly)
-                        {
-                            m_features.setFlag(Feature::VR);
-                            m_features.setFlag(Feature::Flatscreen, false);
-                        }
-                    }
-                }
-            }
-            else if (section.name == "appinfo.extended")
-            {
-                for (const auto &[key, value] : std::as_const(section.keys))
-                {
-                    if (key == "vacmacmodulecache"_L1 || key == "vacmodulecache"_L1 || key == "vacmodulefilename"_L1)
-                        m_features.setFlag(Feature::Anticheat);
-                }
-            }
+        for (const auto &[id, option] : appInfo.launchOptions.asKeyValueRange())
+        {
+            auto &lo = m_executables[id];
+            if (!option.executable.isEmpty())
+                lo.executable = m_installDir + '/' + option.executable;
+            if (option.type == "vr"_L1 || option.type == "openxr"_L1)
+                m_features.setFlag(Feature::VR);
+            if (option.oslist.contains("windows"_L1))
+                lo.platform = Platform::Windows;
+            if (option.oslist.contains("linux"_L1))
+                lo.platform = Platform::Linux;
+            if (option.oslist.contains("macos"_L1))
+                lo.platform = Platform::MacOS;
         }
 
-        detectGameEngine();
-        detectArchitectures();
-        detectAnticheat();
+        m_logoWidth = appInfo.logoWidth;
+        m_logoHeight = appInfo.logoHeight;
+        const auto &posStr = appInfo.logoPinnedPosition;
+        if (posStr.startsWith("Center"_L1))
+            m_logoVPosition = LogoPosition::Center;
+        else if (posStr.startsWith("Top"_L1))
+            m_logoVPosition = LogoPosition::Top;
+        else if (posStr.startsWith("Bottom"_L1))
+            m_logoVPosition = LogoPosition::Bottom;
+
+        if (posStr.endsWith("Center"_L1))
+            m_logoHPosition = LogoPosition::Center;
+        else if (posStr.endsWith("Left"_L1))
+            m_logoHPosition = LogoPosition::Left;
+        else if (posStr.endsWith("Right"_L1))
+            m_logoHPosition = LogoPosition::Right;
+
+        if (appInfo.hasVac)
+            m_features.setFlag(Feature::Anticheat);
 
         m_valid = m_executables.size() > 0;
     }
@@ -275,6 +228,17 @@ Steam::Steam(QObject *parent)
         qCInfo(SteamLog) << "Steam not found";
     else
         qCInfo(SteamLog) << "Found Steam:" << m_steamRoot;
+
+    connect(this, &Store::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        for (int i = first; i <= last && !m_hasSteamVR; ++i)
+        {
+            if (m_games[i]->id() == "250820"_L1)
+            {
+                m_hasSteamVR = true;
+                emit hasSteamVRChanged(m_hasSteamVR);
+            }
+        }
+    });
 }
 
 Steam *Steam::instance()
@@ -297,16 +261,28 @@ void Steam::scanStore()
 {
     if (m_steamRoot.isEmpty())
         return;
+    const auto scan = beginScan();
+    if (!scan)
+        return;
 
     qCDebug(SteamLog) << "Scanning Steam library";
-    beginResetModel();
 
-    for (const auto game : std::as_const(m_games))
-        game->deleteLater();
-    m_games.clear();
     m_hasSteamVR = false;
+    emit hasSteamVRChanged(m_hasSteamVR);
+
+    // Even reading the library folders and appinfo.vdf takes long enough to be noticeable, so keep it off the GUI thread
+    ScanExecutor::instance()->submit([this, scan] { scanLibrary(scan); });
+}
 
-    const auto parseLibraryFolders = [this](const QString &vdfPath) -> bool {
+void Steam::scanLibrary(const std::shared_ptr<Scan> &scan)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // appid and library folder of every installed app
+    QList<QPair<QString, QString>> installedApps;
+
+    const auto parseLibraryFolders = [&installedApps](const QString &vdfPath) -> bool {
         qCDebug(SteamLog) << "Parsing libraryfolders.vdf from" << vdfPath;
         std::ifstream vdfFile{vdfPath.toStdString()};
 
@@ -316,20 +292,9 @@ void Steam::scanStore()
             for (const auto &[_, folder] : libraryFolders.childs)
             {
                 qCDebug(SteamLog) << "Scanning Steam drive:" << folder->attribs["path"];
+                const auto path = QString::fromStdString(folder->attribs["path"]);
                 for (const auto &[appId, _] : folder->childs["apps"]->attribs)
-                {
-                    if (auto g = new SteamGame{QString::fromStdString(appId),
-                                               QString::fromStdString(folder->attribs["path"]),
-                                               this};
-                        g->isValid())
-                    {
-                        m_games.push_back(g);
-                        if (g->id() == "250820"_L1)
-                            m_hasSteamVR = true;
-                    }
-                    else
-                        g->deleteLater();
-                }
+                    installedApps.push_back({QString::fromStdString(appId), path});
             }
         }
         catch (const std::length_error &e)
@@ -348,12 +313,41 @@ void Steam::scanStore()
     if (const QFileInfo fi{m_steamRoot + "/steamapps/libraryfolders.vdf"_L1}; fi.exists() && fi.isFile())
         parsed = parseLibraryFolders({fi.absoluteFilePath()});
     if (const QFileInfo fi{m_steamRoot + "/config/libraryfolders.vdf"_L1}; !parsed && fi.exists() && fi.isFile())
-        parseLibraryFolders({fi.absoluteFilePath()});
+        parsed = parseLibraryFolders({fi.absoluteFilePath()});
     if (!parsed)
         qCWarning(SteamLog) << "Could not find libraryfolders.vdf";
 
-    endResetModel();
-    emit hasSteamVRChanged(m_hasSteamVR);
+    // Get all the appinfo parsing out of the way in one go so it can be spread across threads
+    SteamAppInfoCache appInfoCache{m_steamRoot};
+    QList<AppId_t> appIds;
+    appIds.reserve(installedApps.size());
+    for (const auto &[id, _] : std::as_const(installedApps))
+        appIds.push_back(id.toUInt());
+    appInfoCache.refresh(appIds);
+
+    const auto imageIndex = std::make_shared<const SteamImageIndex>(m_steamRoot);
+
+    // Reading each app's manifest and walking its install dir is the slow part, and every game can do that on its own
+    for (const auto &[id, library] : std::as_const(installedApps))
+    {
+        auto appInfo = appInfoCache.appInfo(id.toUInt());
+        if (!appInfo)
+        {
+            qCWarning(SteamLog) << "Could not find" << id << "in appinfo.vdf";
+            continue;
+        }
+
+        scanGame(
+            scan,
+            [id, library, appInfo = std::move(*appInfo), imageIndex] {
+                return new SteamGame{id, library, appInfo, *imageIndex, nullptr};
+            },
+            library);
+    }
+    endScan(scan);
+
+    appInfoCache.save();
+    qCDebug(SteamLog) << "Read" << installedApps.size() << "Steam apps in" << timer.elapsed() << "ms";
 }
 
 #include "Steam.moc"
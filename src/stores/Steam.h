@@ -29,6 +29,8 @@ private:
     ~Steam() = default;
 
     void scanStore() final;
+    // Runs on the scan executor
+    void scanLibrary(const std::shared_ptr<Scan> &scan);
 
     QString m_steamRoot;
     bool m_hasSteamVR = false;
@@ -0,0 +1,305 @@
+#include "SteamAppInfo.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtConcurrentMap>
+
+Q_LOGGING_CATEGORY(SteamAppInfoLog, "steam.appinfo")
+
+namespace
+{
+    constexpr quint32 CACHE_MAGIC = 0x4B534149; // "KSAI"
+    constexpr quint32 CACHE_VERSION = 1;
+
+    QString cachePath()
+    {
+        return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/steam_appinfo.cache"_L1;
+    }
+} // namespace
+
+SteamAppInfo SteamAppInfo::parse(AppInfoVDF::AppInfo *info, const AppInfoVDF::ParseContext &ctx)
+{
+    enum AppInfoKey
+    {
+        LaunchExecutable,
+        LaunchType,
+        LaunchOsList,
+        LaunchConfigOsList,
+        CommonName,
+        CommonInstallDir,
+        CommonType,
+        CommonIcon,
+        CommonClientIcon,
+        CommonOpenVRSupport,
+        CommonOpenXRSupport,
+        CommonOnlyVRSupport,
+        LogoWidth,
+        LogoHeight,
+        LogoPinnedPosition,
+        VacMacModuleCache,
+        VacModuleCache,
+        VacModuleFilename,
+    };
+    static const AppInfoVDF::AppInfo::Query query{{
+        "appinfo.config.launch.*.executable",
+        "appinfo.config.launch.*.type",
+        "appinfo.config.launch.*.oslist",
+        "appinfo.config.launch.*.config.oslist",
+        "appinfo.common.name",
+        "appinfo.common.installdir",
+        "appinfo.common.type",
+        "appinfo.common.icon",
+        "appinfo.common.clienticon",
+        "appinfo.common.openvrsupport",
+        "appinfo.common.openxrsupport",
+        "appinfo.common.onlyvrsupport",
+        "appinfo.common.library_assets.logo_position.width_pct",
+        "appinfo.common.library_assets.logo_position.height_pct",
+        "appinfo.common.library_assets.logo_position.pinned_position",
+        "appinfo.extended.vacmacmodulecache",
+        "appinfo.extended.vacmodulecache",
+        "appinfo.extended.vacmodulefilename",
+    }};
+
+    SteamAppInfo result;
+    result.changeNumber = info->change_num;
+    result.sha1 = QByteArray{reinterpret_cast<const char *>(info->sha1sum), sizeof(info->sha1sum)};
+
+    AppInfoVDF::AppInfo::SectionDesc app_desc{};
+    app_desc.blob = info->getRootSection(ctx.version, &app_desc.size);
+
+    query.run(app_desc, ctx, [&result](const AppInfoVDF::AppInfo::Query::Match &match) {
+        switch (match.path)
+        {
+        case LaunchExecutable:
+        case LaunchType:
+        case LaunchOsList:
+        case LaunchConfigOsList:
+        {
+            // appinfo.config.launch.<id>
+            auto &lo = result.launchOptions[QByteArrayView{match.sections[3]}.toInt()];
+            if (match.path == LaunchExecutable)
+                lo.executable = QString::fromUtf8(match.toString());
+            else if (match.path == LaunchType)
+                lo.type = QString::fromUtf8(match.toString());
+            else
+                lo.oslist = QString::fromUtf8(match.toString());
+            break;
+        }
+
+        case CommonName:
+            result.name = QString::fromUtf8(match.toString());
+            break;
+        case CommonInstallDir:
+            result.installDir = QString::fromUtf8(match.toString());
+            break;
+        case CommonType:
+            result.type = QString::fromUtf8(match.toString());
+            break;
+        case CommonIcon:
+        case CommonClientIcon:
+            result.iconIds.push_back(QString::fromUtf8(match.toString()));
+            break;
+        case CommonOpenVRSupport:
+        case CommonOpenXRSupport:
+            result.vrSupport = result.vrSupport || match.toInt() != 0;
+            break;
+        case CommonOnlyVRSupport:
+            result.vrOnly = match.toInt() != 0;
+            break;
+
+        case LogoWidth:
+            result.logoWidth = match.toDouble();
+            break;
+        case LogoHeight:
+            result.logoHeight = match.toDouble();
+            break;
+        case LogoPinnedPosition:
+            result.logoPinnedPosition = QString::fromUtf8(match.toString());
+            break;
+
+        case VacMacModuleCache:
+        case VacModuleCache:
+        case VacModuleFilename:
+            result.hasVac = true;
+            break;
+        }
+    });
+
+    return result;
+}
+
+QDataStream &operator<<(QDataStream &s, const SteamAppInfo::LaunchOption &lo)
+{
+    return s << lo.executable << lo.type << lo.oslist;
+}
+
+QDataStream &operator>>(QDataStream &s, SteamAppInfo::LaunchOption &lo)
+{
+    return s >> lo.executable >> lo.type >> lo.oslist;
+}
+
+QDataStream &operator<<(QDataStream &s, const SteamAppInfo &info)
+{
+    return s << info.changeNumber << info.sha1 << info.name << info.installDir << info.type << info.iconIds
+             << info.launchOptions << info.vrSupport << info.vrOnly << info.logoWidth << info.logoHeight
+             << info.logoPinnedPosition << info.hasVac;
+}
+
+QDataStream &operator>>(QDataStream &s, SteamAppInfo &info)
+{
+    return s >> info.changeNumber >> info.sha1 >> info.name >> info.installDir >> info.type >> info.iconIds >>
+           info.launchOptions >> info.vrSupport >> info.vrOnly >> info.logoWidth >> info.logoHeight >>
+           info.logoPinnedPosition >> info.hasVac;
+}
+
+SteamAppInfoCache::SteamAppInfoCache(const QString &steamRoot)
+    : m_vdfPath{steamRoot + "/appcache/appinfo.vdf"_L1}
+{
+    QFile file{cachePath()};
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream s{&file};
+    s.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    s >> magic >> version;
+    if (magic != CACHE_MAGIC || version != CACHE_VERSION)
+    {
+        qCInfo(SteamAppInfoLog) << "Ignoring appinfo cache with unknown format" << Qt::hex << magic << version;
+        return;
+    }
+
+    qint64 vdfSize;
+    QDateTime vdfModified;
+    QHash<AppId_t, SteamAppInfo> apps;
+    s >> vdfSize >> vdfModified >> apps;
+    if (s.status() != QDataStream::Ok)
+    {
+        qCWarning(SteamAppInfoLog) << "Failed to read appinfo cache" << file.fileName();
+        return;
+    }
+
+    m_vdfSize = vdfSize;
+    m_vdfModified = vdfModified;
+    m_apps = std::move(apps);
+
+    const QFileInfo vdf{m_vdfPath};
+    m_vdfUnchanged = vdf.exists() && vdf.size() == m_vdfSize && vdf.lastModified() == m_vdfModified;
+    qCDebug(SteamAppInfoLog) << "Loaded" << m_apps.size() << "apps from appinfo cache,"
+                             << (m_vdfUnchanged ? "appinfo.vdf is unchanged" : "appinfo.vdf has changed");
+}
+
+void SteamAppInfoCache::refresh(const QList<AppId_t> &appids)
+{
+    QList<AppId_t> unchecked;
+    for (const auto appid : appids)
+    {
+        m_used.insert(appid);
+        if (!m_vdfUnchanged || !m_apps.contains(appid))
+            unchecked.push_back(appid);
+    }
+
+    if (unchecked.isEmpty())
+        return;
+
+    // Steam rewrites appinfo.vdf in place while it runs, so a scan that overlaps with that has to start over from the new
+    // file. If it keeps changing, the cache keeps what it had.
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        if (refreshFrom(*AppInfoVDF::load(m_vdfPath), unchecked))
+            return;
+        qCWarning(SteamAppInfoLog) << "appinfo.vdf changed while it was being read";
+    }
+}
+
+bool SteamAppInfoCache::refreshFrom(const AppInfoVDF &vdf, const QList<AppId_t> &appids)
+{
+    QList<AppId_t> removed;
+    QList<QPair<AppId_t, AppInfoVDF::AppInfo *>> stale;
+    for (const auto appid : appids)
+    {
+        auto *info = vdf.game(appid);
+        if (!info)
+        {
+            removed.push_back(appid);
+            continue;
+        }
+
+        const QByteArrayView sha1{reinterpret_cast<const char *>(info->sha1sum), sizeof(info->sha1sum)};
+        if (const auto cached = m_apps.constFind(appid);
+            cached != m_apps.cend() && cached->changeNumber == info->change_num && cached->sha1 == sha1)
+            continue;
+
+        stale.push_back({appid, info});
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // Each app's record is independent of all the others, so spread them out over every core
+    const auto ctx = vdf.context();
+    const auto parsed = QtConcurrent::blockingMapped<QList<SteamAppInfo>>(
+        stale, [&ctx](const QPair<AppId_t, AppInfoVDF::AppInfo *> &app) { return SteamAppInfo::parse(app.second, ctx); });
+
+    if (!vdf.isCurrent())
+        return false;
+
+    if (m_vdfSize != vdf.fileSize() || m_vdfModified != vdf.lastModified())
+    {
+        m_vdfSize = vdf.fileSize();
+        m_vdfModified = vdf.lastModified();
+        m_dirty = true;
+    }
+
+    for (const auto appid : std::as_const(removed))
+        m_dirty = m_apps.remove(appid) || m_dirty;
+
+    for (qsizetype i = 0; i < stale.size(); ++i)
+        m_apps.insert(stale[i].first, parsed[i]);
+    m_dirty = m_dirty || !stale.isEmpty();
+
+    if (!stale.isEmpty())
+        qCDebug(SteamAppInfoLog) << "Parsed appinfo for" << stale.size() << "apps in" << timer.elapsed() << "ms";
+    return true;
+}
+
+std::optional<SteamAppInfo> SteamAppInfoCache::appInfo(AppId_t appid) const
+{
+    if (const auto it = m_apps.constFind(appid); it != m_apps.cend())
+        return *it;
+    return std::nullopt;
+}
+
+void SteamAppInfoCache::save()
+{
+    if (m_used.isEmpty())
+        return;
+
+    const auto pruned = m_apps.removeIf(
+        [this](const std::pair<const AppId_t &, SteamAppInfo &> &entry) { return !m_used.contains(entry.first); });
+    if (!m_dirty && pruned == 0)
+        return;
+
+    QSaveFile file{cachePath()};
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCWarning(SteamAppInfoLog) << "Failed to write appinfo cache" << file.fileName();
+        return;
+    }
+
+    QDataStream s{&file};
+    s.setVersion(QDataStream::Qt_6_0);
+    s << CACHE_MAGIC << CACHE_VERSION << m_vdfSize << m_vdfModified << m_apps;
+
+    if (file.commit())
+        m_dirty = false;
+    else
+        qCWarning(SteamAppInfoLog) << "Failed to write appinfo cache" << file.fileName();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <optional>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+#include "VDF.h"
+
+// The fields Kaon reads out of an app's record in appinfo.vdf. Values are kept as Steam wrote them; interpreting them is
+// up to SteamGame.
+struct SteamAppInfo
+{
+    struct LaunchOption
+    {
+        QString executable; // Relative to the install dir
+        QString type;
+        QString oslist;
+    };
+
+    uint32_t changeNumber = 0;
+    QByteArray sha1;
+
+    QString name;
+    QString installDir;
+    QString type;
+    QStringList iconIds; // icon and clienticon, in the order they appear
+    QMap<int, LaunchOption> launchOptions;
+    bool vrSupport = false;
+    bool vrOnly = false;
+    double logoWidth = 0;
+    double logoHeight = 0;
+    QString logoPinnedPosition;
+    bool hasVac = false;
+
+    static SteamAppInfo parse(AppInfoVDF::AppInfo *info, const AppInfoVDF::ParseContext &ctx);
+};
+
+QDataStream &operator<<(QDataStream &s, const SteamAppInfo::LaunchOption &lo);
+QDataStream &operator>>(QDataStream &s, SteamAppInfo::LaunchOption &lo);
+QDataStream &operator<<(QDataStream &s, const SteamAppInfo &info);
+QDataStream &operator>>(QDataStream &s, SteamAppInfo &info);
+
+// Keeps the parsed appinfo of installed apps on disk between runs. As long as appinfo.vdf hasn't changed, everything is
+// served from the cache without opening appinfo.vdf at all; otherwise each app is checked against its record's change
+// number and SHA-1 and only reparsed if those differ.
+class SteamAppInfoCache
+{
+public:
+    explicit SteamAppInfoCache(const QString &steamRoot);
+
+    // Brings the given apps up to date, reparsing any stale ones in parallel. Call this once with every app you're going to
+    // look up before calling appInfo().
+    void refresh(const QList<AppId_t> &appids);
+    std::optional<SteamAppInfo> appInfo(AppId_t appid) const;
+
+    // Writes the cache back to disk, dropping any apps that weren't asked for since it was loaded
+    void save();
+
+private:
+    // Returns false without touching the cache if appinfo.vdf changed while it was being read
+    bool refreshFrom(const AppInfoVDF &vdf, const QList<AppId_t> &appids);
+
+    QString m_vdfPath;
+    qint64 m_vdfSize = -1;
+    QDateTime m_vdfModified;
+    bool m_vdfUnchanged = false;
+    bool m_dirty = false;
+
+    QHash<AppId_t, SteamAppInfo> m_apps;
+    QSet<AppId_t> m_used;
+};
@@ -1,9 +1,54 @@
 #include "Store.h"
 
+#include <atomic>
+
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+#include <QMutex>
 #include <QSettings>
+#include <QThread>
 #include <QTimer>
 
+#include "DetectionCache.h"
+#include "GameDetector.h"
 #include "GamesFilterModel.h"
+#include "ScanExecutor.h"
+
+Q_LOGGING_CATEGORY(StoreLog, "store")
+
+namespace
+{
+    // How long a scan holds on to finished games before handing them to the model. The first games are always handed over
+    // right away so that the library doesn't sit empty while the rest are scanned.
+    constexpr int BATCH_INTERVAL_MS = 100;
+
+    // How long detection may take for one game, and for a whole scan. A game on a stalled network mount or a dying disk
+    // shouldn't keep the rest of the library waiting.
+    constexpr int GAME_DEADLINE_MS = 15 * 1000;
+    constexpr int SCAN_DEADLINE_MS = 2 * 60 * 1000;
+} // namespace
+
+struct Store::Scan
+{
+    // Which of the store's scans this is. Only the latest one may add games to the model.
+    quint64 generation = 0;
+
+    QMutex mutex;
+    QList<Game *> finished; // Detected, but not in the model yet
+    QList<Game *> timedOut; // Ran out of time for detection, to be retried once the scan is over
+    int outstanding = 0;
+    bool ended = false;
+    bool flushQueued = false;
+
+    // Set once detection should wrap up: the scan is out of time or has been cancelled
+    std::atomic_bool stopped = false;
+    std::atomic_bool cancelled = false;
+
+    // Only touched on the main thread
+    bool firstFlush = true;
+    QElapsedTimer timer;
+};
 
 Store::Store(QObject *parent)
     : QAbstractListModel{parent}
@@ -12,6 +57,16 @@ Store::Store(QObject *parent)
     connect(this, &Store::rowsRemoved, this, &Store::countChanged);
     connect(this, &Store::modelReset, this, &Store::countChanged);
 
+    // Detection can finish after a game has been added, which may change whether it passes the filters
+    connect(this, &Store::rowsInserted, this, [this](const QModelIndex &, int first, int last) {
+        for (int i = first; i <= last; ++i)
+            watchGame(m_games[i]);
+    });
+    connect(this, &Store::modelReset, this, [this] {
+        for (const auto game : std::as_const(m_games))
+            watchGame(game);
+    });
+
     // Don't you just love how constructors can't call virtual functions?
     QTimer::singleShot(0, this, [this] {
         QSettings settings;
@@ -52,3 +107,206 @@ int Store::count() const
 {
     return m_games.count();
 }
+
+void Store::appendGames(const QList<Game *> &games)
+{
+    if (games.isEmpty())
+        return;
+
+    beginInsertRows({}, m_games.size(), m_games.size() + games.size() - 1);
+    for (const auto game : games)
+    {
+        game->setParent(this);
+        m_games.push_back(game);
+    }
+    endInsertRows();
+}
+
+void Store::setScanning(bool scanning)
+{
+    if (m_scanning == scanning)
+        return;
+
+    m_scanning = scanning;
+    emit scanningChanged(m_scanning);
+}
+
+void Store::cancelScan()
+{
+    if (!m_scan)
+        return;
+
+    qCInfo(StoreLog) << "Cancelling" << metaObject()->className() << "scan";
+
+    // Work that's already running can't be interrupted, only asked to stop, so rather than waiting for it the scan is
+    // detached and whatever it still finds gets added as it turns up
+    const auto scan = std::exchange(m_scan, nullptr);
+    scan->cancelled = true;
+    scan->stopped = true;
+    flush(scan);
+
+    DetectionCache::instance()->save();
+    setScanning(false);
+}
+
+std::shared_ptr<Store::Scan> Store::beginScan()
+{
+    if (m_scanning)
+    {
+        qCDebug(StoreLog) << metaObject()->className() << "scan already in progress";
+        return nullptr;
+    }
+
+    beginResetModel();
+    for (const auto game : std::as_const(m_games))
+        game->deleteLater();
+    m_games.clear();
+    endResetModel();
+
+    m_scan = std::make_shared<Scan>();
+    m_scan->generation = ++m_scanGeneration;
+    m_scan->timer.start();
+    setScanning(true);
+
+    QTimer::singleShot(SCAN_DEADLINE_MS, this, [this, scan = std::weak_ptr{m_scan}] {
+        if (const auto s = scan.lock(); s && s == m_scan)
+        {
+            qCWarning(StoreLog) << metaObject()->className() << "scan ran out of time, leaving detection for later";
+            s->stopped = true;
+        }
+    });
+
+    return m_scan;
+}
+
+void Store::scanGame(const std::shared_ptr<Scan> &scan, std::function<Game *()> build, const QString &location)
+{
+    {
+        QMutexLocker lock{&scan->mutex};
+        ++scan->outstanding;
+    }
+
+    ScanExecutor::instance()->submit(
+        [this, scan, build = std::move(build)] {
+            Game *game = nullptr;
+            try
+            {
+                game = build();
+            }
+            catch (const std::exception &e)
+            {
+                qCWarning(StoreLog) << "Failed to build game:" << e.what();
+            }
+
+            // Games built on this thread are ours to delete or move; anything else already belongs to the main thread
+            const bool local = game && game->thread() == QThread::currentThread();
+            bool timedOut = false;
+            if (game && !game->isValid())
+            {
+                if (local)
+                    delete game;
+                else
+                    game->deleteLater();
+                game = nullptr;
+            }
+            else if (game)
+            {
+                DetectionBudget budget;
+                budget.deadline = QDeadlineTimer{GAME_DEADLINE_MS};
+                budget.cancelled = &scan->stopped;
+                game->detect(budget);
+
+                timedOut = game->detectionPending() && !scan->cancelled && budget.exhausted();
+                if (timedOut)
+                    qCInfo(StoreLog) << "Detection for" << game->name() << "ran out of time";
+
+                if (local)
+                    game->moveToThread(thread());
+            }
+
+            QMutexLocker lock{&scan->mutex};
+            if (game)
+                scan->finished.push_back(game);
+            if (timedOut)
+                scan->timedOut.push_back(game);
+            --scan->outstanding;
+            queueFlush(scan);
+        },
+        location);
+}
+
+void Store::endScan(const std::shared_ptr<Scan> &scan)
+{
+    QMutexLocker lock{&scan->mutex};
+    scan->ended = true;
+    queueFlush(scan);
+}
+
+void Store::queueFlush(const std::shared_ptr<Scan> &scan)
+{
+    if (scan->flushQueued)
+        return;
+    scan->flushQueued = true;
+
+    QMetaObject::invokeMethod(
+        this,
+        [this, scan] {
+            if (scan->firstFlush)
+                flush(scan);
+            else
+                QTimer::singleShot(BATCH_INTERVAL_MS, this, [this, scan] { flush(scan); });
+        },
+        Qt::QueuedConnection);
+}
+
+void Store::flush(const std::shared_ptr<Scan> &scan)
+{
+    QList<Game *> games;
+    QList<Game *> timedOut;
+    bool done = false;
+    {
+        QMutexLocker lock{&scan->mutex};
+        games = std::exchange(scan->finished, {});
+        scan->flushQueued = false;
+        done = scan->ended && scan->outstanding == 0;
+        if (done)
+            timedOut = std::exchange(scan->timedOut, {});
+    }
+
+    // Stragglers from a cancelled scan are only wanted if nothing has reset the model since, whether or not the scan that
+    // did is still running
+    if (scan->generation != m_scanGeneration)
+    {
+        qDeleteAll(games);
+        return;
+    }
+
+    if (!games.isEmpty())
+    {
+        scan->firstFlush = false;
+        appendGames(games);
+    }
+
+    if (done && scan == m_scan)
+    {
+        qCDebug(StoreLog) << "Scanned" << m_games.size() << "games for" << metaObject()->className() << "in"
+                          << scan->timer.elapsed() << "ms";
+        m_scan.reset();
+        DetectionCache::instance()->save();
+        setScanning(false);
+
+        // Now that the scan isn't competing for the disk, give the slow ones as long as they need
+        for (const auto game : std::as_const(timedOut))
+            game->finishDetection();
+    }
+}
+
+void Store::watchGame(Game *game)
+{
+    const auto gameChanged = [this, game] {
+        if (const auto row = m_games.indexOf(game); row >= 0)
+            emit dataChanged(index(row), index(row));
+    };
+    connect(game, &Game::engineChanged, this, gameChanged);
+    connect(game, &Game::featuresChanged, this, gameChanged);
+}
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+
 #include <QAbstractListModel>
 
 #include "Game.h"
@@ -10,6 +13,7 @@ class Store : public QAbstractListModel
 
     Q_PROPERTY(QString storeRoot READ storeRoot CONSTANT FINAL)
     Q_PROPERTY(int count READ count NOTIFY countChanged FINAL)
+    Q_PROPERTY(bool scanning READ scanning NOTIFY scanningChanged FINAL)
 
 public:
     enum Roles
@@ -26,12 +30,50 @@ public:
     virtual QString storeRoot() const = 0;
     Q_INVOKABLE virtual void scanStore() = 0;
     int count() const;
+    bool scanning() const { return m_scanning; }
+    // Stops detection for the running scan and hands the library back right away. Games that are still being read are
+    // added as they turn up, with their detection left pending.
+    Q_INVOKABLE void cancelScan();
 
 signals:
     void countChanged();
+    void scanningChanged(bool scanning);
 
 protected:
     explicit Store(QObject *parent = nullptr);
 
+    // Adds games that were built on a scan thread. They must already have been moved to this store's thread.
+    void appendGames(const QList<Game *> &games);
+    void setScanning(bool scanning);
+
+    struct Scan;
+
+    // A scan clears the model, then hands games to scanGame() as it finds them, then calls endScan(). Returns nullptr if
+    // a scan is already running.
+    std::shared_ptr<Scan> beginScan();
+    // Runs build() and then detection on the scan executor, and adds the game to the model once it's done. build() should
+    // return a game without a parent, or nullptr. Games built elsewhere can be passed through by returning them, as long
+    // as they belong to the main thread. location is any path on the drive the game is installed on, and keeps games on
+    // the same drive from all hitting it at once. Its drive is looked up once per location, so prefer the library the game
+    // is in over its own install dir. Can be called from any thread.
+    //
+    // Detection gets a few seconds per game, and stops for every game once the scan runs out of time or is cancelled.
+    // Games that run out of time are added anyway with their detection pending, and retried after the scan.
+    void scanGame(const std::shared_ptr<Scan> &scan, std::function<Game *()> build, const QString &location = {});
+    // No more games are coming. The scan finishes once the ones already handed over are done.
+    void endScan(const std::shared_ptr<Scan> &scan);
+
     QList<Game *> m_games;
+    bool m_scanning = false;
+
+private:
+    // Has the main thread move finished games into the model. Must be called with the scan's mutex held.
+    void queueFlush(const std::shared_ptr<Scan> &scan);
+    void flush(const std::shared_ptr<Scan> &scan);
+
+    void watchGame(Game *game);
+
+    std::shared_ptr<Scan> m_scan;
+    // Counts the scans started, so that late games from older ones can be told apart
+    quint64 m_scanGeneration = 0;
 };
@@ -0,0 +1,237 @@
+#include "AppInfoWriter.h"
+
+#include <utility>
+
+#include <QCryptographicHash>
+#include <QtEndian>
+
+namespace
+{
+    constexpr char SECTION_BEGIN = 0x00;
+    constexpr char STRING = 0x01;
+    constexpr char INT32 = 0x02;
+    constexpr char INT64 = 0x07;
+    constexpr char SECTION_END = 0x08;
+
+    template <typename T> void append(QByteArray &data, T value)
+    {
+        char bytes[sizeof(T)];
+        qToLittleEndian(value, bytes);
+        data.append(bytes, sizeof(T));
+    }
+
+    template <typename T> void overwrite(QByteArray &data, qsizetype pos, T value)
+    {
+        qToLittleEndian(value, data.data() + pos);
+    }
+
+    QByteArray hexId(uint32_t seed)
+    {
+        return QCryptographicHash::hash(QByteArray::number(seed), QCryptographicHash::Sha1).toHex();
+    }
+} // namespace
+
+AppInfoWriter::AppInfoWriter(uint32_t version)
+    : m_version{version}
+{
+    // Steam puts a magic number in the upper three bytes, but only the lowest one is the version
+    append<uint32_t>(m_data, 0x07564400 | version);
+    append<uint32_t>(m_data, 1); // universe
+
+    // Where the string table starts, filled in by finish()
+    if (m_version >= 0x29)
+        append<uint64_t>(m_data, 0);
+}
+
+void AppInfoWriter::beginApp(AppId_t appid, uint32_t changeNumber)
+{
+    Q_ASSERT(m_appStart < 0);
+    m_appStart = m_data.size();
+
+    const auto sha1 = QCryptographicHash::hash(QByteArray::number(appid) + '/' + QByteArray::number(changeNumber),
+                                               QCryptographicHash::Sha1);
+
+    append<uint32_t>(m_data, appid);
+    append<uint32_t>(m_data, 0); // size, filled in by endApp()
+    append<uint32_t>(m_data, 2); // state
+    append<uint32_t>(m_data, 1700000000 + changeNumber); // last_update
+    append<uint64_t>(m_data, 0); // access_token
+    m_data.append(sha1);
+    append<uint32_t>(m_data, changeNumber);
+    if (m_version > 0x27)
+        m_data.append(sha1); // sha1_sec
+}
+
+void AppInfoWriter::endApp()
+{
+    Q_ASSERT(m_appStart >= 0);
+
+    // Closes the app's key values as a whole
+    m_data.append(SECTION_END);
+
+    // The size counts everything after the app ID and the size itself
+    overwrite<uint32_t>(m_data, m_appStart + sizeof(uint32_t), m_data.size() - m_appStart - 2 * sizeof(uint32_t));
+    m_appStart = -1;
+}
+
+void AppInfoWriter::beginSection(QByteArrayView name)
+{
+    m_data.append(SECTION_BEGIN);
+    addName(name);
+}
+
+void AppInfoWriter::endSection()
+{
+    m_data.append(SECTION_END);
+}
+
+void AppInfoWriter::addString(QByteArrayView name, QByteArrayView value)
+{
+    m_data.append(STRING);
+    addName(name);
+    m_data.append(value.data(), value.size());
+    m_data.append('\0');
+}
+
+void AppInfoWriter::addInt32(QByteArrayView name, int32_t value)
+{
+    m_data.append(INT32);
+    addName(name);
+    append(m_data, value);
+}
+
+void AppInfoWriter::addInt64(QByteArrayView name, int64_t value)
+{
+    m_data.append(INT64);
+    addName(name);
+    append(m_data, value);
+}
+
+QByteArray AppInfoWriter::finish()
+{
+    Q_ASSERT(m_appStart < 0);
+
+    append<AppId_t>(m_data, 0); // Marks the last app
+
+    if (m_version >= 0x29)
+    {
+        overwrite<uint64_t>(m_data, 2 * sizeof(uint32_t), m_data.size());
+        append<uint32_t>(m_data, m_strings.size());
+        for (const auto &string : std::as_const(m_strings))
+        {
+            m_data.append(string);
+            m_data.append('\0');
+        }
+    }
+
+    return std::exchange(m_data, {});
+}
+
+QByteArray AppInfoWriter::synthetic(uint32_t version, int appCount)
+{
+    AppInfoWriter w{version};
+
+    for (int i = 1; i <= appCount; ++i)
+    {
+        const AppId_t appid = i * 10;
+        const auto name = "Synthetic Game "_ba + QByteArray::number(appid);
+
+        w.beginApp(appid, 1000 + i);
+        w.beginSection("appinfo");
+        w.addInt32("appid", appid);
+
+        w.beginSection("common");
+        w.addString("name", name);
+        w.addString("type", i % 5 == 0 ? "Tool" : "Game");
+        w.addString("oslist", "windows,linux");
+        w.addString("icon", hexId(appid));
+        w.addString("clienticon", hexId(appid + 1));
+        w.addInt32("metacritic_score", i % 100);
+        if (i % 7 == 0)
+            w.addString("openvrsupport", "1");
+        w.beginSection("library_assets");
+        w.addString("library_capsule", "en");
+        w.beginSection("logo_position");
+        w.addString("pinned_position", "BottomLeft");
+        w.addString("width_pct", "50");
+        w.addString("height_pct", "35.5");
+        w.endSection();
+        w.endSection();
+        w.beginSection("header_image");
+        w.addString("english", "header.jpg");
+        w.endSection();
+        w.addInt64("store_asset_mtime", 1600000000LL + i);
+        w.endSection();
+
+        w.beginSection("extended");
+        w.addString("developer", "Studio " + QByteArray::number(i % 50));
+        w.addString("homepage", "https://example.com/" + QByteArray::number(appid));
+        if (i % 3 == 0)
+            w.addString("vacmodulefilename", "sourceinit.dat");
+        w.endSection();
+
+        w.beginSection("config");
+        w.addString("installdir", name);
+        w.beginSection("launch");
+        for (int option = 0; option < 1 + i % 3; ++option)
+        {
+            w.beginSection(QByteArray::number(option));
+            w.addString("executable", option % 2 ? "bin/game.sh" : "bin/game.exe");
+            if (option == 0)
+                w.addString("type", "default");
+            w.beginSection("config");
+            w.addString("oslist", option % 2 ? "linux" : "windows");
+            w.endSection();
+            w.endSection();
+        }
+        w.endSection();
+        w.endSection();
+
+        // Most of a real record is depots, none of which Kaon looks at
+        w.beginSection("depots");
+        for (int depot = 1; depot <= 8; ++depot)
+        {
+            w.beginSection(QByteArray::number(appid + depot));
+            w.beginSection("manifests");
+            w.beginSection("public");
+            w.addString("gid", QByteArray::number(Q_UINT64_C(7000000000000000000) + appid * depot));
+            w.addInt64("size", 1000000LL * depot);
+            w.addInt64("download", 600000LL * depot);
+            w.endSection();
+            w.endSection();
+            w.addString("maxsize", QByteArray::number(2000000 * depot));
+            w.endSection();
+        }
+        w.beginSection("branches");
+        w.beginSection("public");
+        w.addString("buildid", QByteArray::number(100000 + i));
+        w.addString("timeupdated", QByteArray::number(1700000000 + i));
+        w.endSection();
+        w.endSection();
+        w.endSection();
+
+        w.endSection();
+        w.endApp();
+    }
+
+    return w.finish();
+}
+
+void AppInfoWriter::addName(QByteArrayView name)
+{
+    if (m_version < 0x29)
+    {
+        m_data.append(name.data(), name.size());
+        m_data.append('\0');
+        return;
+    }
+
+    const auto key = name.toByteArray();
+    auto index = m_stringIndices.constFind(key);
+    if (index == m_stringIndices.cend())
+    {
+        index = m_stringIndices.insert(key, m_strings.size());
+        m_strings.push_back(key);
+    }
+    append<uint32_t>(m_data, *index);
+}
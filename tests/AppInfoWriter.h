@@ -0,0 +1,50 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QList>
+
+#include "VDF.h"
+
+// Builds appinfo.vdf files the way Steam lays them out, for any of the versions AppInfoVDF understands. Apps are written
+// one at a time as a tree of sections and keys:
+//
+//     AppInfoWriter w{0x29};
+//     w.beginApp(440, 1234);
+//     w.beginSection("appinfo");
+//     w.addString("name", "Team Fortress 2");
+//     w.endSection();
+//     w.endApp();
+//     file.write(w.finish());
+class AppInfoWriter
+{
+public:
+    explicit AppInfoWriter(uint32_t version);
+
+    void beginApp(AppId_t appid, uint32_t changeNumber);
+    void endApp();
+
+    void beginSection(QByteArrayView name);
+    void endSection();
+    void addString(QByteArrayView name, QByteArrayView value);
+    void addInt32(QByteArrayView name, int32_t value);
+    void addInt64(QByteArrayView name, int64_t value);
+
+    // The whole file, including the string table for 0x29
+    QByteArray finish();
+
+    // A file of appCount apps shaped like real ones: a handful of common keys, a few launch options and a pile of depots
+    // and other keys that Kaon never asks for. Apps are numbered from 10 in steps of 10.
+    static QByteArray synthetic(uint32_t version, int appCount);
+
+private:
+    void addName(QByteArrayView name);
+
+    uint32_t m_version;
+    QByteArray m_data;
+    qsizetype m_appStart = -1;
+
+    QHash<QByteArray, uint32_t> m_stringIndices;
+    QList<QByteArray> m_strings;
+};
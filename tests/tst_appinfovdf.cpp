@@ -0,0 +1,411 @@
+#include <algorithm>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+
+#include "AppInfoWriter.h"
+#include "VDF.h"
+
+using Section = AppInfoVDF::AppInfo::Section;
+using Query = AppInfoVDF::AppInfo::Query;
+
+namespace
+{
+    constexpr int APP_COUNT = 5000;
+
+    // The same paths SteamAppInfo::parse() asks for
+    const QList<QByteArrayView> QUERY_PATHS{
+        "appinfo.config.launch.*.executable",
+        "appinfo.config.launch.*.type",
+        "appinfo.config.launch.*.oslist",
+        "appinfo.config.launch.*.config.oslist",
+        "appinfo.common.name",
+        "appinfo.common.installdir",
+        "appinfo.common.type",
+        "appinfo.common.icon",
+        "appinfo.common.clienticon",
+        "appinfo.common.openvrsupport",
+        "appinfo.common.openxrsupport",
+        "appinfo.common.onlyvrsupport",
+        "appinfo.common.library_assets.logo_position.width_pct",
+        "appinfo.common.library_assets.logo_position.height_pct",
+        "appinfo.common.library_assets.logo_position.pinned_position",
+        "appinfo.extended.vacmacmodulecache",
+        "appinfo.extended.vacmodulecache",
+        "appinfo.extended.vacmodulefilename",
+    };
+
+    QByteArray describe(qsizetype path, const QByteArray &key, Section::_TokenOp type, const void *value)
+    {
+        auto result = QByteArray::number(path) + ' ' + key + " = "_ba;
+        switch (type)
+        {
+        case Section::String:
+            return result + static_cast<const char *>(value);
+        case Section::Int32:
+            return result + QByteArray::number(qFromUnaligned<int32_t>(value));
+        case Section::Int64:
+            return result + QByteArray::number(qFromUnaligned<int64_t>(value));
+        default:
+            return result + '?';
+        }
+    }
+
+    // How the string table was indexed before it switched to memchr(), one byte at a time
+    QList<uint32_t> indexStringsPerByte(QByteArrayView strings, uint32_t count)
+    {
+        QList<uint32_t> offsets;
+        if (count == 0)
+            return offsets;
+        offsets.reserve(count);
+        offsets.push_back(0);
+
+        auto str = strings.data();
+        const auto end = strings.data() + strings.size();
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            while (*str++ != '\0' && str < end)
+                ;
+            if (str > end)
+                str = strings.data();
+            offsets.push_back(static_cast<uint32_t>(str - strings.data()));
+        }
+        return offsets;
+    }
+
+    // The strings of a 0x29 file and how many of them there are
+    std::pair<QByteArrayView, uint32_t> stringTable(const QByteArray &data)
+    {
+        const auto table = qFromLittleEndian<uint64_t>(data.constData() + 2 * sizeof(uint32_t));
+        const auto count = qFromLittleEndian<uint32_t>(data.constData() + table);
+        return {QByteArrayView{data}.sliced(table + sizeof(uint32_t)), count};
+    }
+
+    AppInfoVDF::AppInfo::SectionDesc rootSection(AppInfoVDF::AppInfo *info, uint32_t version)
+    {
+        AppInfoVDF::AppInfo::SectionDesc desc{};
+        desc.blob = info->getRootSection(version, &desc.size);
+        return desc;
+    }
+} // namespace
+
+class TestAppInfoVDF : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void load_data() { versions(); }
+    void load();
+    void game_data() { versions(); }
+    void game();
+    void sectionParse_data() { versions(); }
+    void sectionParse();
+    void queryRun_data() { versions(); }
+    void queryRun();
+
+    void queryMatchesParse_data() { versions(); }
+    void queryMatchesParse();
+
+    void stringTableScan_data();
+    void stringTableScan();
+    void stringTableScanMatchesPerByte();
+
+    void reloadsWhenRewritten();
+    void survivesShrinkInPlace();
+    void stringTableOutOfBounds();
+    void tooManyStrings();
+    void truncated_data() { versions(); }
+    void truncated();
+
+private:
+    void versions();
+    QString write(const QString &name, const QByteArray &data);
+
+    QTemporaryDir m_dir;
+    QHash<uint, QString> m_paths;
+    QByteArray m_appInfo29;
+};
+
+void TestAppInfoVDF::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    for (const uint version : {0x27, 0x28, 0x29})
+    {
+        const auto name = "appinfo_"_L1 + QString::number(version, 16) + ".vdf"_L1;
+        const auto data = AppInfoWriter::synthetic(version, APP_COUNT);
+        m_paths.insert(version, write(name, data));
+        if (version == 0x29)
+            m_appInfo29 = data;
+    }
+}
+
+void TestAppInfoVDF::versions()
+{
+    QTest::addColumn<uint>("version");
+    QTest::newRow("0x27") << 0x27u;
+    QTest::newRow("0x28") << 0x28u;
+    QTest::newRow("0x29") << 0x29u;
+}
+
+QString TestAppInfoVDF::write(const QString &name, const QByteArray &data)
+{
+    const auto path = m_dir.filePath(name);
+    QFile f{path};
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(data) != data.size())
+        qFatal("Could not write %s", qPrintable(path));
+    return path;
+}
+
+void TestAppInfoVDF::load()
+{
+    QFETCH(uint, version);
+
+    // Nothing else holds on to the file, so every load reads and indexes it from scratch
+    std::shared_ptr<AppInfoVDF> vdf;
+    QBENCHMARK
+    {
+        vdf.reset();
+        vdf = AppInfoVDF::load(m_paths[version]);
+    }
+
+    QVERIFY(vdf->isCurrent());
+    QCOMPARE(vdf->context().version, version);
+    for (int i = 1; i <= APP_COUNT; ++i)
+        QVERIFY(vdf->game(i * 10));
+    QVERIFY(!vdf->game(5));
+    QVERIFY(!vdf->game((APP_COUNT + 1) * 10));
+}
+
+void TestAppInfoVDF::game()
+{
+    QFETCH(uint, version);
+    const auto vdf = AppInfoVDF::load(m_paths[version]);
+
+    int found = 0;
+    QBENCHMARK
+    {
+        found = 0;
+        for (int i = 1; i <= APP_COUNT; ++i)
+            found += vdf->game(i * 10) != nullptr;
+    }
+    QCOMPARE(found, APP_COUNT);
+}
+
+void TestAppInfoVDF::sectionParse()
+{
+    QFETCH(uint, version);
+    const auto vdf = AppInfoVDF::load(m_paths[version]);
+    const auto ctx = vdf->context();
+
+    qsizetype sections = 0;
+    QBENCHMARK
+    {
+        sections = 0;
+        for (int i = 1; i <= APP_COUNT; ++i)
+        {
+            Section section;
+            QVERIFY(section.parse(rootSection(vdf->game(i * 10), version), ctx));
+            sections += section.finished_sections.size();
+        }
+    }
+    QVERIFY(sections > APP_COUNT);
+}
+
+void TestAppInfoVDF::queryRun()
+{
+    QFETCH(uint, version);
+    const auto vdf = AppInfoVDF::load(m_paths[version]);
+    const auto ctx = vdf->context();
+    const Query query{QUERY_PATHS};
+
+    int names = 0;
+    QBENCHMARK
+    {
+        names = 0;
+        for (int i = 1; i <= APP_COUNT; ++i)
+        {
+            query.run(rootSection(vdf->game(i * 10), version), ctx, [&names](const Query::Match &match) {
+                names += QUERY_PATHS[match.path] == "appinfo.common.name";
+            });
+        }
+    }
+    QCOMPARE(names, APP_COUNT);
+}
+
+void TestAppInfoVDF::queryMatchesParse()
+{
+    QFETCH(uint, version);
+    const auto vdf = AppInfoVDF::load(m_paths[version]);
+    const auto ctx = vdf->context();
+    const Query query{QUERY_PATHS};
+
+    QList<QByteArrayList> patterns;
+    for (const auto path : QUERY_PATHS)
+        patterns.push_back(path.toByteArray().split('.'));
+
+    for (int i = 1; i <= APP_COUNT; i += 7)
+    {
+        const auto desc = rootSection(vdf->game(i * 10), version);
+
+        // Everything the full parse finds under any of the paths...
+        QByteArrayList expected;
+        Section section;
+        QVERIFY(section.parse(desc, ctx));
+        for (const auto &finished : std::as_const(section.finished_sections))
+        {
+            for (const auto &[key, value] : std::as_const(finished.keys))
+            {
+                const auto fullKey = finished.name.toUtf8() + '.' + key;
+                const auto segments = fullKey.split('.');
+                for (qsizetype p = 0; p < patterns.size(); ++p)
+                {
+                    if (std::ranges::equal(patterns[p], segments, [](const QByteArray &pattern, const QByteArray &segment) {
+                            return pattern == "*" || pattern == segment;
+                        }))
+                        expected.push_back(describe(p, fullKey, value.first, value.second));
+                }
+            }
+        }
+
+        // ...is exactly what the query reports
+        QByteArrayList actual;
+        query.run(desc, ctx, [&actual, &patterns](const Query::Match &match) {
+            QByteArray fullKey;
+            for (const auto name : match.sections)
+            {
+                fullKey += name;
+                fullKey += '.';
+            }
+            fullKey += patterns[match.path].last();
+            actual.push_back(describe(match.path, fullKey, match.type, match.value));
+        });
+
+        std::ranges::sort(expected);
+        std::ranges::sort(actual);
+        QVERIFY(!expected.isEmpty());
+        QCOMPARE(actual, expected);
+    }
+}
+
+void TestAppInfoVDF::stringTableScan_data()
+{
+    QTest::addColumn<bool>("perByte");
+    QTest::newRow("memchr") << false;
+    QTest::newRow("per byte") << true;
+}
+
+void TestAppInfoVDF::stringTableScan()
+{
+    QFETCH(bool, perByte);
+    const auto [strings, count] = stringTable(m_appInfo29);
+
+    QList<uint32_t> offsets;
+    QBENCHMARK
+    {
+        offsets = perByte ? indexStringsPerByte(strings, count) : AppInfoVDF::indexStrings(strings, count);
+    }
+    QCOMPARE(offsets.size(), qsizetype(count));
+}
+
+void TestAppInfoVDF::stringTableScanMatchesPerByte()
+{
+    const auto [strings, count] = stringTable(m_appInfo29);
+
+    // Every depot ID is a name of its own, so there are plenty of strings to get wrong
+    QVERIFY(count > APP_COUNT);
+    QCOMPARE(AppInfoVDF::indexStrings(strings, count), indexStringsPerByte(strings, count));
+
+    // The last string may end right at the end of the file, or be cut off
+    QCOMPARE(AppInfoVDF::indexStrings(strings.chopped(1), count), indexStringsPerByte(strings.chopped(1), count));
+    QCOMPARE(AppInfoVDF::indexStrings(strings.chopped(3), count), indexStringsPerByte(strings.chopped(3), count));
+
+    // A file that loads its names this way resolves them the same way too
+    const auto vdf = AppInfoVDF::load(m_paths[0x29]);
+    const auto ctx = vdf->context();
+    const auto expected = indexStringsPerByte(strings, count);
+    QCOMPARE(ctx.stringOffsets.size(), expected.size());
+    QVERIFY(std::ranges::equal(ctx.stringOffsets, expected));
+}
+
+void TestAppInfoVDF::reloadsWhenRewritten()
+{
+    const auto path = write("rewritten.vdf"_L1, AppInfoWriter::synthetic(0x29, 10));
+    const auto before = AppInfoVDF::load(path);
+    QVERIFY(AppInfoVDF::load(path) == before);
+
+    write("rewritten.vdf"_L1, AppInfoWriter::synthetic(0x29, 20));
+    QVERIFY(!before->isCurrent());
+
+    const auto after = AppInfoVDF::load(path);
+    QVERIFY(after != before);
+    QVERIFY(after->isCurrent());
+    QVERIFY(!before->game(200));
+    QVERIFY(after->game(200));
+}
+
+void TestAppInfoVDF::survivesShrinkInPlace()
+{
+    const auto path = write("shrunk.vdf"_L1, AppInfoWriter::synthetic(0x29, 20));
+    const auto before = AppInfoVDF::load(path);
+    QVERIFY(before->game(200));
+
+    // Truncating the file under a loaded snapshot used to take the next read of it down with SIGBUS
+    write("shrunk.vdf"_L1, AppInfoWriter::synthetic(0x29, 1));
+    QVERIFY(!before->isCurrent());
+
+    Section section;
+    QVERIFY(section.parse(rootSection(before->game(200), 0x29), before->context()));
+    QVERIFY(!section.finished_sections.isEmpty());
+}
+
+void TestAppInfoVDF::stringTableOutOfBounds()
+{
+    auto data = AppInfoWriter::synthetic(0x29, 10);
+    qToLittleEndian<uint64_t>(data.size() * 2, data.data() + 2 * sizeof(uint32_t));
+
+    const auto vdf = AppInfoVDF::load(write("bad_table.vdf"_L1, data));
+    QVERIFY(!vdf->game(10));
+}
+
+void TestAppInfoVDF::tooManyStrings()
+{
+    auto data = AppInfoWriter::synthetic(0x29, 10);
+    const auto table = qFromLittleEndian<uint64_t>(data.constData() + 2 * sizeof(uint32_t));
+    qToLittleEndian<uint32_t>(0xFFFFFFFF, data.data() + table);
+
+    // Names still resolve, since the real strings are all there
+    const auto vdf = AppInfoVDF::load(write("too_many_strings.vdf"_L1, data));
+    QVERIFY(vdf->game(10));
+    Section section;
+    QVERIFY(section.parse(rootSection(vdf->game(10), 0x29), vdf->context()));
+    QVERIFY(std::ranges::any_of(section.finished_sections,
+                                [](const Section::SectionData &s) { return s.name == "appinfo.common"_L1; }));
+}
+
+void TestAppInfoVDF::truncated()
+{
+    QFETCH(uint, version);
+    auto data = AppInfoWriter::synthetic(version, 100);
+
+    // Without its string table, a 0x29 file loses its names rather than its records
+    if (version >= 0x29)
+        data.truncate(qFromLittleEndian<uint64_t>(data.constData() + 2 * sizeof(uint32_t)));
+    else
+        data.truncate(data.size() / 2);
+
+    const auto vdf = AppInfoVDF::load(write("truncated_"_L1 + QString::number(version, 16) + ".vdf"_L1, data));
+    if (version < 0x29)
+    {
+        QVERIFY(vdf->game(10));
+        QVERIFY(!vdf->game(1000));
+    }
+    else
+        QVERIFY(!vdf->game(10));
+}
+
+QTEST_GUILESS_MAIN(TestAppInfoVDF)
+#include "tst_appinfovdf.moc"
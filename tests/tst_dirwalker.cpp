@@ -0,0 +1,171 @@
+#include <algorithm>
+
+#include <QDirIterator>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "DirWalker.h"
+
+namespace
+{
+    // 100 top level dirs of 10 subdirs of 100 files each, about the size of a big game's install
+    constexpr int TOP_DIRS = 100;
+    constexpr int SUB_DIRS = 10;
+    constexpr int FILES = 100;
+
+    void touch(const QString &path)
+    {
+        QFile f{path};
+        if (!f.open(QIODevice::WriteOnly))
+            qFatal("Could not create %s", qPrintable(path));
+    }
+
+    // Every entry as "path" or "path/" for directories, sorted since the two walks don't list them in the same order
+    QStringList walkerEntries(const QString &root)
+    {
+        QStringList entries;
+        DirWalker walker{root};
+        while (walker.next())
+        {
+            const auto path = QString::fromUtf8(walker.path().data(), walker.path().size());
+            entries.push_back(walker.isDir() ? path + '/' : path);
+        }
+        entries.sort();
+        return entries;
+    }
+
+    QStringList iteratorEntries(const QString &root)
+    {
+        QStringList entries;
+        QDirIterator it{root, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                        QDirIterator::Subdirectories};
+        while (it.hasNext())
+        {
+            const auto entry = it.nextFileInfo();
+            const auto path = entry.filePath().sliced(root.size());
+            entries.push_back(entry.isDir() && !entry.isSymLink() ? path + '/' : path);
+        }
+        entries.sort();
+        return entries;
+    }
+} // namespace
+
+class TestDirWalker : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void walk_data();
+    void walk();
+
+    void matchesQDirIterator();
+    void symlinkedRoot();
+    void symlinksNotFollowed();
+    void missingRoot();
+
+private:
+    QTemporaryDir m_dir;
+    QString m_big;
+    QString m_small;
+};
+
+void TestDirWalker::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    m_big = m_dir.filePath("big"_L1);
+    for (int top = 0; top < TOP_DIRS; ++top)
+    {
+        for (int sub = 0; sub < SUB_DIRS; ++sub)
+        {
+            const auto dir = "%1/%2/%3"_L1.arg(m_big).arg(top).arg(sub);
+            QVERIFY(QDir{}.mkpath(dir));
+            for (int file = 0; file < FILES; ++file)
+                touch("%1/file%2.dat"_L1.arg(dir).arg(file));
+        }
+    }
+
+    // Something of everything a walk has to get right
+    m_small = m_dir.filePath("small"_L1);
+    QVERIFY(QDir{}.mkpath(m_small + "/Game_Data/Managed"_L1));
+    QVERIFY(QDir{}.mkpath(m_small + "/.hidden"_L1));
+    QVERIFY(QDir{}.mkpath(m_small + "/empty"_L1));
+    touch(m_small + "/Game.exe"_L1);
+    touch(m_small + "/Game_Data/Managed/Assembly-CSharp.dll"_L1);
+    touch(m_small + "/.hidden/.config"_L1);
+    touch(m_small + QString::fromUtf8("/Ünïcödé.pak"));
+    QVERIFY(QFile::link(m_small + "/Game_Data"_L1, m_small + "/linked_dir"_L1));
+    QVERIFY(QFile::link(m_small + "/Game.exe"_L1, m_small + "/linked_file"_L1));
+}
+
+void TestDirWalker::walk_data()
+{
+    QTest::addColumn<bool>("qt");
+    QTest::newRow("DirWalker") << false;
+    QTest::newRow("QDirIterator") << true;
+}
+
+void TestDirWalker::walk()
+{
+    QFETCH(bool, qt);
+
+    // Only counting, like a detection rule that finds nothing, so the walk itself is all that gets measured
+    qsizetype count = 0;
+    QBENCHMARK
+    {
+        count = 0;
+        if (qt)
+        {
+            QDirIterator it{m_big, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                            QDirIterator::Subdirectories};
+            while (it.hasNext())
+            {
+                it.next();
+                ++count;
+            }
+        }
+        else
+        {
+            DirWalker walker{m_big};
+            while (walker.next())
+                ++count;
+        }
+    }
+    QCOMPARE(count, qsizetype(TOP_DIRS + TOP_DIRS * SUB_DIRS + TOP_DIRS * SUB_DIRS * FILES));
+}
+
+void TestDirWalker::matchesQDirIterator()
+{
+    QCOMPARE(walkerEntries(m_small), iteratorEntries(m_small));
+    QCOMPARE(walkerEntries(m_big), iteratorEntries(m_big));
+}
+
+void TestDirWalker::symlinkedRoot()
+{
+    // Libraries often live on another drive with a symlink pointing at them
+    const auto link = m_dir.filePath("linked_root"_L1);
+    QVERIFY(QFile::link(m_small, link));
+    QCOMPARE(walkerEntries(link), walkerEntries(m_small));
+    QVERIFY(!walkerEntries(link).isEmpty());
+}
+
+void TestDirWalker::symlinksNotFollowed()
+{
+    const auto entries = walkerEntries(m_small);
+    QVERIFY(entries.contains("/linked_dir"_L1));
+    QVERIFY(entries.contains("/linked_file"_L1));
+    QVERIFY(!entries.contains("/linked_dir/"_L1));
+    QVERIFY(std::ranges::none_of(entries, [](const QString &path) { return path.startsWith("/linked_dir/"_L1); }));
+}
+
+void TestDirWalker::missingRoot()
+{
+    DirWalker walker{m_dir.filePath("missing"_L1)};
+    QVERIFY(!walker.next());
+}
+
+QTEST_GUILESS_MAIN(TestDirWalker)
+#include "tst_dirwalker.moc"
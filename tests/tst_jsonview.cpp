@@ -0,0 +1,378 @@
+#include <limits>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+
+#include "JsonView.h"
+
+namespace
+{
+    constexpr int GAME_COUNT = 2000;
+    // What toInt() falls back to in the number tests
+    constexpr int NOT_AN_INT = -12345;
+
+    // Laid out like Legendary's library: a few fields Kaon wants among a lot that it doesn't
+    QByteArray library()
+    {
+        // Long, and full of things that need escaping
+        const auto description =
+            QString::fromUtf8("A game.\nWith \"quotes\", a \\ backslash and \xC3\xBC" "nicode. ").repeated(8);
+
+        QJsonArray games;
+        for (int i = 0; i < GAME_COUNT; ++i)
+        {
+            const auto id = "game%1"_L1.arg(i);
+
+            QJsonArray images;
+            for (const auto type : {"DieselGameBox"_L1, "DieselGameBoxTall"_L1, "DieselGameBoxLogo"_L1, "Thumbnail"_L1})
+                images.push_back(QJsonObject{{"type"_L1, type},
+                                             {"url"_L1, "https://cdn.example.com/%1/%2.jpg"_L1.arg(id, type)},
+                                             {"width"_L1, 1200},
+                                             {"height"_L1, 1600}});
+
+            const QJsonObject attributes{
+                {"CanRunOffline"_L1, QJsonObject{{"type"_L1, "STRING"_L1}, {"value"_L1, "true"_L1}}},
+                {"FolderName"_L1, QJsonObject{{"type"_L1, "STRING"_L1}, {"value"_L1, id}}},
+            };
+
+            QJsonArray tags;
+            for (int tag = 0; tag < 10; ++tag)
+                tags.push_back(tag * 100 + i % 7);
+
+            games.push_back(QJsonObject{
+                {"app_name"_L1, id},
+                {"app_title"_L1, QString::fromUtf8("Game \"%1\" \xC3\xA9" "dition").arg(i)},
+                {"metadata"_L1,
+                 QJsonObject{{"description"_L1, description},
+                             {"developer"_L1, "Studio %1"_L1.arg(i % 50)},
+                             {"keyImages"_L1, images},
+                             {"tags"_L1, tags},
+                             {"customAttributes"_L1, attributes}}},
+                {"install"_L1,
+                 QJsonObject{{"install_path"_L1, "/games/%1"_L1.arg(id)},
+                             {"version"_L1, "1.%1.0"_L1.arg(i)},
+                             {"install_size"_L1, 1000000.0 * i},
+                             {"is_dlc"_L1, false}}},
+            });
+        }
+        return QJsonDocument{games}.toJson(QJsonDocument::Indented);
+    }
+
+    struct Summary
+    {
+        QString id;
+        QString title;
+        QString installPath;
+        QString cover;
+        int tagSum = 0;
+
+        bool operator==(const Summary &) const = default;
+    };
+} // namespace
+
+class TestJsonView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void lookup_data();
+    void lookup();
+
+    void types();
+    void escapes();
+    void surrogatePairs();
+    void nested();
+    void iteration();
+    void truncated();
+    void numbers_data();
+    void numbers();
+    void matchesQJsonDocument();
+
+private:
+    QList<Summary> summarize(bool qt) const;
+
+    QByteArray m_library;
+};
+
+void TestJsonView::initTestCase()
+{
+    m_library = library();
+}
+
+QList<Summary> TestJsonView::summarize(bool qt) const
+{
+    QList<Summary> summaries;
+    summaries.reserve(GAME_COUNT);
+
+    if (qt)
+    {
+        for (const auto &value : QJsonDocument::fromJson(m_library).array())
+        {
+            const auto game = value.toObject();
+            Summary s{game["app_name"_L1].toString(),
+                      game["app_title"_L1].toString(),
+                      game["install"_L1]["install_path"_L1].toString()};
+            for (const auto &image : game["metadata"_L1]["keyImages"_L1].toArray())
+            {
+                if (image["type"_L1].toString() == "DieselGameBoxTall"_L1)
+                    s.cover = image["url"_L1].toString();
+            }
+            for (const auto &tag : game["metadata"_L1]["tags"_L1].toArray())
+                s.tagSum += tag.toInt();
+            summaries.push_back(s);
+        }
+    }
+    else
+    {
+        for (const auto &game : JsonView{m_library})
+        {
+            Summary s{game["app_name"_L1].toString(),
+                      game["app_title"_L1].toString(),
+                      game["install"_L1]["install_path"_L1].toString()};
+            for (const auto &image : game["metadata"_L1]["keyImages"_L1])
+            {
+                if (image["type"_L1].toString() == "DieselGameBoxTall"_L1)
+                    s.cover = image["url"_L1].toString();
+            }
+            for (const auto &tag : game["metadata"_L1]["tags"_L1])
+                s.tagSum += tag.toInt();
+            summaries.push_back(s);
+        }
+    }
+
+    return summaries;
+}
+
+void TestJsonView::lookup_data()
+{
+    QTest::addColumn<bool>("qt");
+    QTest::newRow("JsonView") << false;
+    QTest::newRow("QJsonDocument") << true;
+}
+
+void TestJsonView::lookup()
+{
+    QFETCH(bool, qt);
+
+    QList<Summary> summaries;
+    QBENCHMARK
+    {
+        summaries = summarize(qt);
+    }
+    QCOMPARE(summaries.size(), qsizetype(GAME_COUNT));
+}
+
+void TestJsonView::types()
+{
+    const JsonView json{R"( {"s": "x", "n": -1.5e3, "t": true, "f": false, "z": null, "a": [1], "o": {}} )"};
+    QVERIFY(json.isObject());
+    QCOMPARE(json["s"_L1].type(), JsonView::Type::String);
+    QCOMPARE(json["n"_L1].type(), JsonView::Type::Number);
+    QCOMPARE(json["t"_L1].type(), JsonView::Type::Bool);
+    QCOMPARE(json["f"_L1].type(), JsonView::Type::Bool);
+    QCOMPARE(json["z"_L1].type(), JsonView::Type::Null);
+    QCOMPARE(json["a"_L1].type(), JsonView::Type::Array);
+    QCOMPARE(json["o"_L1].type(), JsonView::Type::Object);
+    QCOMPARE(json["missing"_L1].type(), JsonView::Type::Undefined);
+
+    QCOMPARE(json["t"_L1].toBool(), true);
+    QCOMPARE(json["f"_L1].toBool(true), false);
+    QCOMPARE(json["s"_L1].toBool(true), true);
+    QCOMPARE(json["n"_L1].toString("default"_L1), "default"_L1);
+    QCOMPARE(json["a"_L1].raw().toByteArray(), "[1]"_ba);
+    QCOMPARE(json["o"_L1].raw().toByteArray(), "{}"_ba);
+
+    // Lookups on the wrong type of value, or on nothing at all, come back undefined
+    QVERIFY(json["s"_L1]["x"_L1].isUndefined());
+    QVERIFY(json["o"_L1][0].isUndefined());
+    QVERIFY(json["missing"_L1]["deeper"_L1][3].isUndefined());
+    QVERIFY(JsonView{}.isUndefined());
+    QVERIFY(JsonView{"   "}.isUndefined());
+
+    // Not numbers, whatever they start with
+    QCOMPARE(JsonView{"\"1\""}.toDouble(-1), -1.0);
+    QCOMPARE(JsonView{"true"}.toInt(-1), -1);
+    QCOMPARE(JsonView{"-"}.toDouble(-1), -1.0);
+    QCOMPARE(JsonView{"12abc"}.toInt(-1), -1);
+}
+
+void TestJsonView::escapes()
+{
+    const JsonView json{R"({"plain": "abc", "escaped": "q\"b\\s\/b\bf\fn\nr\rt\t", "a\"b": 1, "end\\": 2, "x": 3})"};
+    QCOMPARE(json["plain"_L1].toString(), "abc"_L1);
+    QCOMPARE(json["escaped"_L1].toString(), "q\"b\\s/b\bf\fn\nr\rt\t"_L1);
+
+    // Escapes in keys count too, and a backslash right before the closing quote doesn't hide the quote
+    QCOMPARE(json["a\"b"_L1].toInt(), 1);
+    QCOMPARE(json["end\\"_L1].toInt(), 2);
+    QCOMPARE(json["x"_L1].toInt(), 3);
+
+    QStringList keys;
+    for (auto it = json.begin(); it != json.end(); ++it)
+        keys.push_back(it.key());
+    QCOMPARE(keys, (QStringList{"plain"_L1, "escaped"_L1, "a\"b"_L1, "end\\"_L1, "x"_L1}));
+
+    // Both spellings of a non-ASCII character are the same string
+    const JsonView unicode{"{\"\\u00e9t\\u00E9\": \"caf\xC3\xA9\", \"\xC3\xA9t\xC3\xA9\": 2}"};
+    QCOMPARE(unicode[QString::fromUtf8("\xC3\xA9t\xC3\xA9")].toString(), QString::fromUtf8("caf\xC3\xA9"));
+    QCOMPARE(unicode[QLatin1StringView{"\xE9t\xE9"}].toString(), QString::fromUtf8("caf\xC3\xA9"));
+}
+
+void TestJsonView::surrogatePairs()
+{
+    const JsonView json{R"({"escaped": "a\ud83d\ude00b", "raw": ")"
+                        "a\xF0\x9F\x98\x80"
+                        R"(b", "\uD83C\uDFAE": true})"};
+    const auto expected = QString::fromUtf8("a\xF0\x9F\x98\x80"
+                                            "b");
+    QCOMPARE(json["escaped"_L1].toString(), expected);
+    QCOMPARE(json["escaped"_L1].toString().size(), qsizetype(4));
+    QCOMPARE(json["raw"_L1].toString(), expected);
+    QVERIFY(json[QString::fromUtf8("\xF0\x9F\x8E\xAE")].toBool());
+
+    // Whatever QJsonDocument makes of it, so does JsonView
+    const auto escaped = R"(["\ud83d\ude00", "\u00e9\u4E2D", "\uD83C\uDFAE!"])"_ba;
+    const auto doc = QJsonDocument::fromJson(escaped);
+    const JsonView view{escaped};
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(view[i].toString(), doc[i].toString());
+}
+
+void TestJsonView::nested()
+{
+    const JsonView json{R"({
+        "a": {"b": [1, {"c": "]}\"{["}, [2, [3]]], "d": 4},
+        "e": [[], [[5]], {}],
+        "f": {"a": "not this one"},
+        "a": "nor this one"
+    })"};
+
+    // Brackets inside strings don't throw off skipping over a value
+    QCOMPARE(json["a"_L1]["b"_L1][1]["c"_L1].toString(), "]}\"{["_L1);
+    QCOMPARE(json["a"_L1]["b"_L1][2][1][0].toInt(), 3);
+    QCOMPARE(json["a"_L1]["d"_L1].toInt(), 4);
+    QCOMPARE(json["e"_L1][1][0][0].toInt(), 5);
+    QVERIFY(json["e"_L1][2].isObject());
+    QVERIFY(json["e"_L1][3].isUndefined());
+    QVERIFY(json["a"_L1]["b"_L1][-1].isUndefined());
+
+    // Only direct members match, and the first one wins
+    QVERIFY(json["c"_L1].isUndefined());
+    QVERIFY(json["a"_L1].isObject());
+    QCOMPARE(json["f"_L1]["a"_L1].toString(), "not this one"_L1);
+}
+
+void TestJsonView::iteration()
+{
+    const JsonView json{R"({"empty": [], "list": [ "x" , 2 ,{"y": 3} , [4] ], "object": {"k1": 1, "k2": {"k3": 3}}})"};
+
+    QVERIFY(json["empty"_L1].begin() == json["empty"_L1].end());
+    QVERIFY(json["object"_L1]["k1"_L1].begin() == json["object"_L1]["k1"_L1].end());
+
+    QByteArrayList elements;
+    for (auto it = json["list"_L1].begin(); it != json["list"_L1].end(); ++it)
+    {
+        QVERIFY(it.key().isEmpty());
+        elements.push_back(it.value().raw().toByteArray());
+    }
+    QCOMPARE(elements, (QByteArrayList{R"("x")", "2", R"({"y": 3})", "[4]"}));
+
+    QStringList keys;
+    for (auto it = json["object"_L1].begin(); it != json["object"_L1].end(); ++it)
+        keys.push_back(it.key());
+    QCOMPARE(keys, (QStringList{"k1"_L1, "k2"_L1}));
+}
+
+void TestJsonView::truncated()
+{
+    // Everything before the end is still there
+    const JsonView json{R"({"a": 1, "b": [2, 3], "c": "unterminated)"};
+    QCOMPARE(json["a"_L1].toInt(), 1);
+    QCOMPARE(json["b"_L1][1].toInt(), 3);
+    QVERIFY(json["c"_L1].isString());
+    QCOMPARE(json["c"_L1].toString("default"_L1), "default"_L1);
+    QVERIFY(json["d"_L1].isUndefined());
+    QVERIFY(json.raw().isEmpty());
+
+    QCOMPARE(JsonView{R"({"a": {"b": 1)"}["a"_L1]["b"_L1].toInt(), 1);
+    QVERIFY(JsonView{R"({"a": {"b": 1)"}["c"_L1].isUndefined());
+    QVERIFY(JsonView{R"({"a": )"}["a"_L1].isUndefined());
+    QVERIFY(JsonView{R"({"a")"}["a"_L1].isUndefined());
+    QVERIFY(JsonView{R"({"a)"}["a"_L1].isUndefined());
+    QVERIFY(JsonView{R"({)"}["a"_L1].isUndefined());
+    QVERIFY(JsonView{R"([)"}[0].isUndefined());
+    QVERIFY(JsonView{R"(["x)"}[0].raw().isEmpty());
+
+    // Anything after a syntax error doesn't exist
+    const JsonView broken{R"({"a": 1 "b": 2})"};
+    QCOMPARE(broken["a"_L1].toInt(), 1);
+    QVERIFY(broken["b"_L1].isUndefined());
+    QVERIFY(JsonView{R"({"a" 1, "b": 2})"}["b"_L1].isUndefined());
+}
+
+void TestJsonView::numbers_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<double>("number");
+    QTest::addColumn<int>("integer");
+
+    QTest::newRow("zero") << "0"_ba << 0.0 << 0;
+    QTest::newRow("negative zero") << "-0"_ba << 0.0 << 0;
+    QTest::newRow("integer") << "42"_ba << 42.0 << 42;
+    QTest::newRow("negative") << "-17"_ba << -17.0 << -17;
+    QTest::newRow("fraction") << "3.5"_ba << 3.5 << NOT_AN_INT;
+    QTest::newRow("whole fraction") << "7.0"_ba << 7.0 << 7;
+    QTest::newRow("exponent") << "1e3"_ba << 1000.0 << 1000;
+    QTest::newRow("negative exponent") << "2.5E-2"_ba << 0.025 << NOT_AN_INT;
+    QTest::newRow("int max") << "2147483647"_ba << 2147483647.0 << 2147483647;
+    QTest::newRow("int min") << "-2147483648"_ba << -2147483648.0 << std::numeric_limits<int>::min();
+    QTest::newRow("past int max") << "2147483648"_ba << 2147483648.0 << NOT_AN_INT;
+    QTest::newRow("large") << "1.5e300"_ba << 1.5e300 << NOT_AN_INT;
+}
+
+void TestJsonView::numbers()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(double, number);
+    QFETCH(int, integer);
+
+    // Inside an array, so that what comes after the number has to be told apart from it
+    const auto array = "[" + json + ", " + json + "]";
+    for (const auto view : {JsonView{json}, JsonView{array}[0], JsonView{array}[1]})
+    {
+        QVERIFY(view.isDouble());
+        QCOMPARE(view.raw().toByteArray(), json);
+        QCOMPARE(view.toDouble(), number);
+        QCOMPARE(view.toInt(NOT_AN_INT), integer);
+    }
+
+    // The same as QJsonValue
+    const auto doc = QJsonDocument::fromJson(array);
+    QCOMPARE(doc[0].toDouble(), number);
+    QCOMPARE(doc[0].toInt(NOT_AN_INT), integer);
+}
+
+void TestJsonView::matchesQJsonDocument()
+{
+    QVERIFY(summarize(false) == summarize(true));
+
+    const auto summaries = summarize(false);
+    QCOMPARE(summaries[7].id, "game7"_L1);
+    QCOMPARE(summaries[7].title, QString::fromUtf8("Game \"7\" \xC3\xA9" "dition"));
+    QCOMPARE(summaries[7].installPath, "/games/game7"_L1);
+    QCOMPARE(summaries[7].cover, "https://cdn.example.com/game7/DieselGameBoxTall.jpg"_L1);
+
+    // Long strings full of escapes decode the same way too
+    const auto doc = QJsonDocument::fromJson(m_library);
+    const JsonView view{m_library};
+    QCOMPARE(view[3]["metadata"_L1]["description"_L1].toString(), doc[3]["metadata"_L1]["description"_L1].toString());
+    QCOMPARE(view[3]["install"_L1]["install_size"_L1].toDouble(), doc[3]["install"_L1]["install_size"_L1].toDouble());
+    QCOMPARE(view[3]["install"_L1]["is_dlc"_L1].toBool(true), doc[3]["install"_L1]["is_dlc"_L1].toBool(true));
+}
+
+QTEST_GUILESS_MAIN(TestJsonView)
+#include "tst_jsonview.moc"
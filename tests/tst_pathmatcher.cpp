@@ -0,0 +1,175 @@
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "PathMatcher.h"
+
+using Anchor = PathMatcher::Anchor;
+
+namespace
+{
+    // A few of GameDetector's patterns, which between them share plenty of prefixes and suffixes
+    const QList<PathMatcher::Pattern> DETECTOR_PATTERNS{
+        {"/vphysics.dll"_L1, Anchor::End, 1},
+        {"/vphysics.so"_L1, Anchor::End, 1},
+        {"/bsppack.so"_L1, Anchor::End, 1},
+        {"/AntiCheatExpert/"_L1, Anchor::Anywhere, 2},
+        {"/BEService.exe"_L1, Anchor::End, 2},
+        {"/BEService_x64.exe"_L1, Anchor::End, 2},
+        {"/EasyAntiCheat.dll"_L1, Anchor::End, 2},
+        {"/EasyAntiCheat_x64.dll"_L1, Anchor::End, 2},
+        {"/Punkbuster"_L1, Anchor::End, 2},
+        {"/Punkbuster/"_L1, Anchor::Anywhere, 2},
+        {".xem"_L1, Anchor::End, 2},
+    };
+
+    // What the matcher has to agree with: every pattern checked on its own
+    uint32_t matchEach(const QList<PathMatcher::Pattern> &patterns, QLatin1StringView path)
+    {
+        uint32_t found = 0;
+        for (const auto &pattern : patterns)
+        {
+            if (pattern.anchor == Anchor::End ? path.endsWith(pattern.text) : path.contains(pattern.text))
+                found |= pattern.group;
+        }
+        return found;
+    }
+
+    // Paths made mostly of bits of the patterns, so that near misses are common
+    QList<QByteArray> randomPaths(int count)
+    {
+        static const QList<QByteArray> pieces{
+            "/", "/bin", "/vphysics", ".dll", ".so", "/BEService", "_x64", ".exe", "/EasyAntiCheat", "/Punkbuster",
+            "Punk", "/AntiCheat", "Expert/", ".xe", "m", "x", "\xC3\xA9", "/Game_Data", "/Engine/Binaries/Win64",
+        };
+
+        auto *random = QRandomGenerator::global();
+        QList<QByteArray> paths;
+        for (int i = 0; i < count; ++i)
+        {
+            QByteArray path;
+            for (int j = random->bounded(1, 8); j > 0; --j)
+                path += pieces[random->bounded(pieces.size())];
+            paths.push_back(path);
+        }
+        return paths;
+    }
+} // namespace
+
+class TestPathMatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void match_data();
+    void match();
+    void overlappingPatterns();
+    void noPatterns();
+    void matchesEachPattern();
+
+    void matchBenchmark_data();
+    void matchBenchmark();
+};
+
+void TestPathMatcher::match_data()
+{
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<uint>("groups");
+
+    QTest::newRow("empty") << ""_ba << 0u;
+    QTest::newRow("end") << "/bin/vphysics.dll"_ba << 1u;
+    QTest::newRow("end in the middle") << "/bin/vphysics.dll.bak"_ba << 0u;
+    QTest::newRow("no slash before") << "/bin/libvphysics.so"_ba << 0u;
+    QTest::newRow("case sensitive") << "/bin/VPhysics.dll"_ba << 0u;
+    QTest::newRow("anywhere") << "/AntiCheatExpert/x/y.dat"_ba << 2u;
+    QTest::newRow("anywhere at the end") << "/a/AntiCheatExpert/"_ba << 2u;
+    QTest::newRow("dir") << "/Punkbuster"_ba << 2u;
+    QTest::newRow("in dir") << "/Punkbuster/pbcl.dll"_ba << 2u;
+    QTest::newRow("longer name") << "/Punkbusters"_ba << 0u;
+    QTest::newRow("prefix of a longer pattern") << "/BEService_x64.exe"_ba << 2u;
+    QTest::newRow("restart after a near miss") << "/BEService_x/BEService.exe"_ba << 2u;
+    QTest::newRow("both groups") << "/Punkbuster/vphysics.so"_ba << 3u;
+    QTest::newRow("suffix") << "/game/data.xem"_ba << 2u;
+    QTest::newRow("after UTF-8") << "/\xC3\xA9\xC3\xA9/bsppack.so"_ba << 1u;
+    QTest::newRow("only UTF-8") << "/\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80"_ba << 0u;
+}
+
+void TestPathMatcher::match()
+{
+    QFETCH(QByteArray, path);
+    QFETCH(uint, groups);
+
+    const PathMatcher matcher{DETECTOR_PATTERNS};
+    QCOMPARE(matcher.match(QLatin1StringView{path}), groups);
+}
+
+void TestPathMatcher::overlappingPatterns()
+{
+    // The classic Aho-Corasick example, where every pattern overlaps another
+    const PathMatcher classic{{
+        {"he"_L1, Anchor::Anywhere, 1},
+        {"she"_L1, Anchor::Anywhere, 2},
+        {"his"_L1, Anchor::Anywhere, 4},
+        {"hers"_L1, Anchor::Anywhere, 8},
+    }};
+    QCOMPARE(classic.match("ushers"_L1), 1u | 2u | 8u);
+    QCOMPARE(classic.match("ahishe"_L1), 1u | 2u | 4u);
+    QCOMPARE(classic.match("hhhhe"_L1), 1u);
+    QCOMPARE(classic.match("h-e"_L1), 0u);
+
+    // Anchored patterns count at the end even when the path got there by way of a longer pattern
+    const PathMatcher anchored{{
+        {"/a.dll"_L1, Anchor::End, 1},
+        {"x/a.dllx"_L1, Anchor::Anywhere, 2},
+    }};
+    QCOMPARE(anchored.match("/x/a.dll"_L1), 1u);
+    QCOMPARE(anchored.match("/x/a.dllx"_L1), 2u);
+    QCOMPARE(anchored.match("/x/a.dllxy"_L1), 2u);
+
+    // Repeats of the first character mustn't lose the match
+    const PathMatcher repeated{{{"aab"_L1, Anchor::Anywhere, 1}}};
+    QCOMPARE(repeated.match("aaab"_L1), 1u);
+    QCOMPARE(repeated.match("abab"_L1), 0u);
+}
+
+void TestPathMatcher::noPatterns()
+{
+    const PathMatcher matcher{{}};
+    QCOMPARE(matcher.match(""_L1), 0u);
+    QCOMPARE(matcher.match("/anything/at/all"_L1), 0u);
+}
+
+void TestPathMatcher::matchesEachPattern()
+{
+    const PathMatcher matcher{DETECTOR_PATTERNS};
+    for (const auto &path : randomPaths(20000))
+    {
+        const QLatin1StringView view{path};
+        QCOMPARE(matcher.match(view), matchEach(DETECTOR_PATTERNS, view));
+    }
+}
+
+void TestPathMatcher::matchBenchmark_data()
+{
+    QTest::addColumn<bool>("each");
+    QTest::newRow("PathMatcher") << false;
+    QTest::newRow("each pattern") << true;
+}
+
+void TestPathMatcher::matchBenchmark()
+{
+    QFETCH(bool, each);
+    const auto paths = randomPaths(20000);
+    const PathMatcher matcher{DETECTOR_PATTERNS};
+
+    uint32_t found = 0;
+    QBENCHMARK
+    {
+        found = 0;
+        for (const auto &path : paths)
+            found |= each ? matchEach(DETECTOR_PATTERNS, QLatin1StringView{path}) : matcher.match(QLatin1StringView{path});
+    }
+    QVERIFY(found != 0);
+}
+
+QTEST_GUILESS_MAIN(TestPathMatcher)
+#include "tst_pathmatcher.moc"
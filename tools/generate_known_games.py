@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+
+# Builds known_games.db, the table KnownGames maps at startup, from data/known_games.json. Engines and architectures are
+# written by name in the JSON and turned into their values from Game.h here, so the two can't drift apart.
+#
+# Usage: generate_known_games.py <path to src/Game.h> <known_games.json> <known_games.db>
+
+import json
+import re
+import struct
+import sys
+
+MAGIC = 0x44474B4B  # "KKGD"
+VERSION = 1
+ANTICHEAT = 1 << 0
+
+
+def read_enum(header, name):
+    """The values of enum name in header, worked out the way the compiler would for the simple cases Game.h uses."""
+    match = re.search(r"enum\s+(?:class\s+)?" + name + r"\s*\{([^}]*)\}", header)
+    if not match:
+        sys.exit(f"Could not find enum {name}")
+
+    values = {}
+    next_value = 0
+    for enumerator in match.group(1).split(","):
+        enumerator = re.sub(r"//.*", "", enumerator).strip()
+        if not enumerator:
+            continue
+        key, _, value = (part.strip() for part in enumerator.partition("="))
+        if value:
+            shift = re.fullmatch(r"(\d+)\s*<<\s*(\d+)", value)
+            next_value = int(shift.group(1)) << int(shift.group(2)) if shift else int(value, 0)
+        values[key] = next_value
+        next_value += 1
+    return values
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(f"Usage: {sys.argv[0]} <Game.h> <known_games.json> <known_games.db>")
+
+    with open(sys.argv[1], encoding="utf-8") as f:
+        header = f.read()
+    engines = read_enum(header, "Engine")
+    architectures = read_enum(header, "Architecture")
+
+    with open(sys.argv[2], encoding="utf-8") as f:
+        games = json.load(f)["games"]
+
+    records = {}
+    for game in games:
+        key = game["key"].encode("utf-8")
+        if key in records:
+            sys.exit(f"{game['key']} is listed twice")
+        if len(key) > 0xFFFF:
+            sys.exit(f"{game['key']} is too long")
+
+        def lookup(values, field, default):
+            name = game.get(field, default)
+            if name not in values:
+                sys.exit(f"{game['key']}: unknown {field} {name}, expected one of {', '.join(values)}")
+            return values[name]
+
+        records[key] = (
+            lookup(engines, "engine", "UnknownEngine"),
+            ANTICHEAT if game.get("anticheat", False) else 0,
+            lookup(architectures, "windowsArch", "UnknownArch"),
+            lookup(architectures, "linuxArch", "UnknownArch"),
+        )
+
+    # KnownGames binary searches the records by their key bytes
+    keys = sorted(records)
+    strings = bytearray()
+    body = bytearray()
+    for key in keys:
+        engine, flags, windows_arch, linux_arch = records[key]
+        body += struct.pack("<IHBBBBH", len(strings), len(key), engine, flags, windows_arch, linux_arch, 0)
+        strings += key
+
+    with open(sys.argv[3], "wb") as f:
+        f.write(struct.pack("<IIII", MAGIC, VERSION, len(keys), len(strings)))
+        f.write(body)
+        f.write(strings)
+
+
+if __name__ == "__main__":
+    main()